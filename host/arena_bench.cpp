@@ -0,0 +1,58 @@
+#include "JsonObject.h"
+#include "payloads.h"
+#include "esp8266.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+
+/* Parse time and memory of /lights trees in an arena, as the firmware 
+ * parses them. The arena is large enough for any payload here, so the 
+ * high water mark is the memory a tree needs. */
+
+static const uint32_t repeats = 200;
+
+static uint8_t arena[1024 * 1024] __attribute__((aligned(8)));
+
+
+int main(void)
+{
+    const uint32_t lampCounts[] = {1, 10, 50};
+
+    JsonObject json(arena, sizeof(arena));
+
+    printf("%6s %8s %10s %10s\n", "lamps", "bytes", "parse us", "arena");
+
+    for(uint32_t lamps : lampCounts)
+    {
+        std::string payload = lightsPayload(lamps);
+        std::vector<char> buffer(payload.size() + 1);
+        std::vector<uint32_t> times;
+
+        for(uint32_t i = 0; i < repeats; i++)
+        {
+            /* The tree is parsed in situ, every run needs a fresh copy */
+            memcpy(buffer.data(), payload.c_str(), buffer.size());
+
+            uint32_t start = micros();
+            bool parsed = json.reparse(buffer.data(), payload.size());
+            times.push_back(micros() - start);
+
+            if(parsed == false)
+            {
+                fprintf(stderr, "Parse of %u lamps failed!\n", lamps);
+                return 1;
+            }
+        }
+
+        std::sort(times.begin(), times.end());
+
+        printf("%6u %8zu %10u %10u\n", lamps, payload.size(), 
+            times[times.size() / 2], json.arenaStats().highWater);
+    }
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+#include "SliderFilter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/* The slider filter on synthetic noisy traces at the tracking rate: a
+ * resting slider with noise and spikes must not produce events, moves
+ * must be followed within the latency bounds. An event is a change of
+ * the filtered value by as many raw steps as the firmware needs to report
+ * one at the finest quantization. */
+
+static const uint32_t rate = 250;
+static const int32_t eventSteps = 3;
+static const uint32_t seeds = 20;
+
+/* Uniform noise of +-4 raw steps and spikes of 40 steps in 1% of the
+ * samples, as measured on the slider */
+static const int32_t noise = 4;
+static const int32_t spike = 40;
+
+static const uint32_t maxRestEvents = 1;        /* in 10 s */
+static const uint32_t maxStepSettle = 150;      /* ms */
+static const uint32_t maxRampSettle = 100;      /* ms after the ramp ends */
+
+
+static uint16_t noisy(double value)
+{
+    int32_t sample = (int32_t)value + (rand() % (2 * noise + 1)) - noise;
+
+    if(rand() % 100 == 0) sample += (rand() % 2) ? spike : -spike;
+
+    if(sample < 0) sample = 0;
+    if(sample > 1023) sample = 1023;
+
+    return sample;
+}
+
+
+static uint32_t ms(uint32_t samples)
+{
+    if(samples == UINT32_MAX) return UINT32_MAX;
+
+    return samples * 1000 / rate;
+}
+
+
+/* Filtered changes while the slider rests at value for 10 s, after the
+ * filter has settled */
+static uint32_t restEvents(SliderFilter& filter, int32_t value)
+{
+    uint16_t out = 0, last = 0;
+    uint32_t events = 0;
+    bool settled = false;
+
+    for(uint32_t i = 0; i < 11 * rate; i++)
+    {
+        if(filter.addSample(noisy(value), &out) == false) continue;
+
+        if(settled == false)
+        {
+            settled = (i >= rate);
+            last = out;
+        }
+        else if(abs((int32_t)out - last) >= eventSteps)
+        {
+            events++;
+            last = out;
+        }
+    }
+
+    return events;
+}
+
+
+/* Samples from the end of the move until the output stays within
+ * eventSteps of the target, the move takes moveSamples */
+static uint32_t settle(SliderFilter& filter, int32_t from, int32_t to,
+        uint32_t moveSamples)
+{
+    uint16_t out;
+    uint32_t reached = UINT32_MAX;
+
+    for(uint32_t i = 0; i < rate; i++) filter.addSample(noisy(from), &out);
+
+    for(uint32_t i = 0; i < moveSamples + 2 * rate; i++)
+    {
+        double value = (i < moveSamples) ?
+            from + (double)(to - from) * i / moveSamples : to;
+
+        if(filter.addSample(noisy(value), &out) == false) continue;
+
+        if(abs((int32_t)out - to) <= eventSteps)
+        {
+            if(reached == UINT32_MAX) reached = i;
+        }
+        else if(i >= moveSamples)
+        {
+            reached = UINT32_MAX;
+        }
+    }
+
+    if(reached == UINT32_MAX) return UINT32_MAX;
+
+    return (reached > moveSamples) ? reached - moveSamples : 0;
+}
+
+
+int main(void)
+{
+    uint32_t failures = 0;
+    uint32_t worstRest = 0, worstStep = 0, worstRamp = 0;
+
+    for(uint32_t seed = 1; seed <= seeds; seed++)
+    {
+        srand(seed);
+        SliderFilter filter(rate);
+
+        uint32_t events = restEvents(filter, 100 + 40 * seed);
+        uint32_t step = ms(settle(filter, 100, 700, 0));
+        uint32_t ramp = ms(settle(filter, 900, 200, 3 * rate / 10));
+
+        if(events > worstRest) worstRest = events;
+        if(step > worstStep) worstStep = step;
+        if(ramp > worstRamp) worstRamp = ramp;
+
+        if((events > maxRestEvents) || (step > maxStepSettle) ||
+            (ramp > maxRampSettle))
+        {
+            printf("FAIL seed %u: %u rest events, step settled after %u ms, "
+                "ramp after %u ms\n", seed, events, step, ramp);
+            failures++;
+        }
+    }
+
+    printf("%u traces, %u failures: at most %u rest events in 10 s, "
+        "step settled within %u ms, ramp within %u ms\n", seeds, failures,
+        worstRest, worstStep, worstRamp);
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,252 @@
+#include "Gestures.h"
+
+#include <stdio.h>
+
+
+/* The gesture recognizer on scripted press and release times: short,
+ * long, double and chord gestures on both sides of their time limits,
+ * a button that is released after a long press and times that wrap. The
+ * buttons are those of the controller, top and middle form the chord and
+ * top waits for a double press. */
+
+static const uint32_t top = 0;
+static const uint32_t middle = 1;
+static const uint32_t bottom = 2;
+
+static const uint32_t longTime = 600;
+static const uint32_t doubleTime = 250;
+
+struct report_s
+{
+    uint32_t button;
+    Gestures::gesture_e gesture;
+    uint16_t trace;
+};
+
+static report_s reports[16];
+static uint32_t numReports;
+
+static uint32_t failures = 0;
+
+
+static void check(bool condition, const char* what)
+{
+    if(condition) return;
+
+    printf("FAIL %s\n", what);
+    failures++;
+}
+
+
+static void gesture(uint32_t button, Gestures::gesture_e gesture,
+        uint16_t trace, void* context)
+{
+    if(numReports < sizeof(reports) / sizeof(reports[0]))
+        reports[numReports] = {button, gesture, trace};
+
+    numReports++;
+}
+
+
+/* Exactly one report since the last call, of the given gesture */
+static bool reported(uint32_t button, Gestures::gesture_e gesture,
+        uint16_t trace)
+{
+    bool match = (numReports == 1) && (reports[0].button == button) &&
+        (reports[0].gesture == gesture) && (reports[0].trace == trace);
+
+    numReports = 0;
+    return match;
+}
+
+
+static bool silent(void)
+{
+    bool quiet = (numReports == 0);
+
+    numReports = 0;
+    return quiet;
+}
+
+
+static void setUp(Gestures& gestures)
+{
+    gestures.setDoubleButtons(1 << top);
+    gestures.setChord(top, middle);
+    numReports = 0;
+}
+
+
+static void shortPress(uint32_t start)
+{
+    Gestures gestures(gesture, nullptr);
+    setUp(gestures);
+
+    gestures.press(bottom, true, start, 1);
+    check(gestures.timeout(start) == longTime, "a press opens a long press");
+
+    gestures.press(bottom, false, start + longTime - 1, 2);
+    check(reported(bottom, Gestures::GESTURE_SHORT, 2),
+        "a release before the long time is a short press");
+    check(gestures.timeout(start + longTime) == UINT32_MAX,
+        "nothing is open after a short press");
+
+    gestures.poll(start + 10 * longTime);
+    check(silent(), "a short press is reported once");
+
+    /* A button with a double press waits for the second press */
+    gestures.press(top, true, start + 10000, 3);
+    gestures.press(top, false, start + 10100, 4);
+    check(silent(), "a double press button waits after a release");
+    check(gestures.timeout(start + 10100) == doubleTime,
+        "the wait is the double time");
+
+    gestures.poll(start + 10100 + doubleTime - 1);
+    check(silent(), "no short press within the double time");
+
+    gestures.poll(start + 10100 + doubleTime);
+    check(reported(top, Gestures::GESTURE_SHORT, 4),
+        "a short press once the double time is over");
+}
+
+
+static void longPress(uint32_t start)
+{
+    Gestures gestures(gesture, nullptr);
+    setUp(gestures);
+
+    gestures.press(bottom, true, start, 1);
+    gestures.poll(start + longTime - 1);
+    check(silent(), "no long press before the long time");
+    check(gestures.timeout(start + longTime - 1) == 1,
+        "the long press is due in 1 ms");
+
+    gestures.poll(start + longTime);
+    check(reported(bottom, Gestures::GESTURE_LONG, 1),
+        "a long press is reported while held");
+
+    /* The release after a long press is not another gesture */
+    gestures.press(bottom, false, start + 3 * longTime, 2);
+    check(silent(), "the release after a long press is ignored");
+    check(gestures.timeout(start + 3 * longTime) == UINT32_MAX,
+        "nothing is open after a long press");
+
+    gestures.press(bottom, true, start + 4 * longTime, 3);
+    gestures.press(bottom, false, start + 4 * longTime + 50, 4);
+    check(reported(bottom, Gestures::GESTURE_SHORT, 4),
+        "the button works again after a long press");
+
+    /* A long press that ran out before a late event is reported first */
+    gestures.press(middle, true, start + 10000, 5);
+    gestures.press(bottom, true, start + 10000 + 2 * longTime, 6);
+    check(reported(middle, Gestures::GESTURE_LONG, 5),
+        "a late event reports the long press first");
+
+    /* Released without a poll in between, the release comes too late */
+    gestures.press(bottom, false, start + 10000 + 3 * longTime, 7);
+    check(reported(bottom, Gestures::GESTURE_LONG, 6),
+        "a late release is a long press");
+
+    gestures.press(middle, false, start + 10000 + 3 * longTime, 8);
+    check(silent(), "the late release of a long press is ignored");
+}
+
+
+static void doublePress(uint32_t start)
+{
+    Gestures gestures(gesture, nullptr);
+    setUp(gestures);
+
+    gestures.press(top, true, start, 1);
+    gestures.press(top, false, start + 100, 2);
+    gestures.press(top, true, start + 100 + doubleTime - 1, 3);
+    check(reported(top, Gestures::GESTURE_DOUBLE, 3),
+        "a second press within the double time");
+
+    gestures.press(top, false, start + 400, 4);
+    gestures.poll(start + 10 * longTime);
+    check(silent(), "the release of a double press is ignored");
+
+    /* Too late for a double press: a short press and a new one */
+    gestures.press(top, true, start + 5000, 5);
+    gestures.press(top, false, start + 5100, 6);
+    gestures.press(top, true, start + 5100 + doubleTime, 7);
+    check(reported(top, Gestures::GESTURE_SHORT, 6),
+        "a second press after the double time is a new press");
+
+    gestures.press(top, false, start + 5400, 8);
+    gestures.poll(start + 5400 + doubleTime);
+    check(reported(top, Gestures::GESTURE_SHORT, 8),
+        "the new press is a short press");
+
+    /* Buttons without a double press report the second press as short */
+    gestures.press(bottom, true, start + 10000, 9);
+    gestures.press(bottom, false, start + 10050, 10);
+    gestures.press(bottom, true, start + 10100, 11);
+    gestures.press(bottom, false, start + 10150, 12);
+    check((numReports == 2) && (reports[1].gesture ==
+        Gestures::GESTURE_SHORT), "two short presses without a double");
+    numReports = 0;
+}
+
+
+static void chord(uint32_t start)
+{
+    Gestures gestures(gesture, nullptr);
+    setUp(gestures);
+
+    gestures.press(middle, true, start, 1);
+    gestures.press(top, true, start + longTime - 1, 2);
+    check(reported(top, Gestures::GESTURE_CHORD, 2),
+        "the chord is reported for its first button");
+
+    gestures.poll(start + 10 * longTime);
+    gestures.press(middle, false, start + 10 * longTime, 3);
+    gestures.press(top, false, start + 10 * longTime, 4);
+    gestures.poll(start + 20 * longTime);
+    check(silent(), "no long or short press after a chord");
+
+    /* The partner held longer than the long time is a long press */
+    gestures.press(top, true, start + 30000, 5);
+    gestures.press(middle, true, start + 30000 + longTime, 6);
+    check(reported(top, Gestures::GESTURE_LONG, 5),
+        "a partner held too long is a long press");
+
+    gestures.press(middle, false, start + 30000 + longTime + 50, 7);
+    check(reported(middle, Gestures::GESTURE_SHORT, 7),
+        "the second button is a press of its own");
+
+    /* A released partner waiting for its double press does not chord */
+    gestures.press(top, false, start + 40000, 8);
+    gestures.press(top, true, start + 41000, 9);
+    gestures.press(top, false, start + 41100, 10);
+    gestures.press(middle, true, start + 41150, 11);
+    check(silent(), "no chord with a released button");
+
+    gestures.press(middle, false, start + 41200, 12);
+    check(reported(middle, Gestures::GESTURE_SHORT, 12),
+        "the pressed button is a short press");
+
+    gestures.poll(start + 41100 + doubleTime);
+    check(reported(top, Gestures::GESTURE_SHORT, 10),
+        "the released button is a short press");
+}
+
+
+int main(void)
+{
+    /* From the start of the clock and across its wrap */
+    static const uint32_t starts[] = {0, UINT32_MAX - 300, UINT32_MAX - 40000};
+
+    for(uint32_t start : starts)
+    {
+        shortPress(start);
+        longPress(start);
+        doublePress(start);
+        chord(start);
+    }
+
+    printf("%u failures\n", failures);
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,101 @@
+#include "json.h"
+#include "json_ref.h"
+#include "payloads.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <string>
+
+
+/* Parse time of json.c against the reference parser without the word at 
+ * a time fast paths, for compact and indented /lights payloads */
+
+static const uint32_t repeats = 500;
+
+typedef json_value* (*parse_t)(json_settings* settings, 
+        const json_char* json, size_t length, char* error);
+typedef void (*free_t)(json_settings* settings, json_value* value);
+
+
+static double nanos(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+
+static void* alloc(size_t size, int zero, void* userData)
+{
+    return zero ? calloc(1, size) : malloc(size);
+}
+
+
+static void release(void* ptr, void* userData)
+{
+    free(ptr);
+}
+
+
+static double parseMicros(parse_t parse, free_t free, 
+        const std::string& payload)
+{
+    json_settings settings = {};
+    settings.mem_alloc = alloc;
+    settings.mem_free = release;
+
+    double best = 0.0;
+
+    /* The best of several rounds hides other load on the host */
+    for(uint32_t round = 0; round < 5; round++)
+    {
+        double start = nanos();
+        for(uint32_t i = 0; i < repeats; i++)
+        {
+            json_value* value = parse(&settings, payload.c_str(), 
+                payload.size(), nullptr);
+            if(value == nullptr) return -1.0;
+
+            free(&settings, value);
+        }
+
+        double elapsed = (nanos() - start) / repeats / 1000.0;
+        if((round == 0) || (elapsed < best)) best = elapsed;
+    }
+
+    return best;
+}
+
+
+int main(void)
+{
+    const uint32_t lampCounts[] = {1, 10, 50};
+
+    printf("%6s %9s %8s %14s %14s %7s\n", "lamps", "layout", "bytes", 
+        "reference us", "parser us", "change");
+
+    for(uint32_t lamps : lampCounts)
+    {
+        for(bool indent : {false, true})
+        {
+            std::string payload = lightsPayload(lamps);
+            if(indent) payload = indentPayload(payload);
+
+            double ref = parseMicros(ref_json_parse_ex, 
+                ref_json_value_free_ex, payload);
+            double parser = parseMicros(json_parse_ex, json_value_free_ex, 
+                payload);
+
+            if((ref < 0.0) || (parser < 0.0)) return 1;
+
+            printf("%6u %9s %8zu %14.1f %14.1f %6.1f%%\n", lamps, 
+                indent ? "indented" : "compact", payload.size(), ref, parser, 
+                100.0 * (parser - ref) / ref);
+        }
+    }
+
+    return 0;
+}
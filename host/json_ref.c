@@ -0,0 +1,11 @@
+#include "json_ref.h"
+
+
+/* The reference parser gets its own names next to the one under test */
+#define json_parse_ex ref_json_parse_ex
+#define json_parse ref_json_parse
+#define json_value_free_ex ref_json_value_free_ex
+#define json_value_free ref_json_value_free
+#define json_value_none ref_json_value_none
+
+#include "ref/json.c"
@@ -0,0 +1,26 @@
+#ifndef JSON_REF_H
+#define JSON_REF_H
+
+
+#include "json.h"
+
+
+/* json.c as it was before the word at a time fast paths, in ref/json.c, 
+ * with the same fixes of the literal bounds. It is the reference of the 
+ * differential test and the parser benchmark. */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+json_value* ref_json_parse_ex(json_settings* settings, const json_char* json, 
+        size_t length, char* error);
+
+void ref_json_value_free_ex(json_settings* settings, json_value* value);
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* JSON_REF_H */
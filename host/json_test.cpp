@@ -0,0 +1,202 @@
+#include "json.h"
+#include "json_ref.h"
+#include "payloads.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+
+/* Differential test of json.c against the reference parser. Every input 
+ * is parsed with and without comments enabled, copied and in situ, and 
+ * the trees and error messages have to be identical. Every prefix of the 
+ * small inputs is parsed as well. The rest of the text stays behind the 
+ * prefix, as in a receive buffer, so reads past the end of the input show 
+ * up as differences or a hanging parser. */
+
+static const char* const edgeCases[] = 
+{
+    "{}", "[]", "[[]]", "{\"a\":{}}", "  {  }  ", "\t\r\n[\r\n1\t,\r 2 ]\n",
+    "true", "false", "null", "[true,false,null]", "[true ,false  ,null   ]",
+    "{\"t\":true,\"f\":false,\"n\":null}", "[tru]", "[fals]", "[nul]",
+    "[truee]", "[false   ,1]", "[null,", "[t", "[f", "[n",
+    "\"\"", "\"abc\"", "\"a\\\"b\"", "\"\\\\\"", "\"\\/\\b\\f\\n\\r\\t\"",
+    "\"\\u0041\"", "\"\\u00e4\\u20ac\"", "\"\\ud83d\\ude00\"", "\"\\ud83d\"",
+    "\"\\u12\"", "\"\\x\"", "\"abc", "\"abcdefgh\\", "\"abcdefghijklmnop\"",
+    "\"abc\\\"def\\\"ghi\\\"jkl\"", "{\"key with spaces\":\"value  with  "
+    "spaces\"}", "\"\xc3\xa4\xe2\x82\xac\"",
+    "0", "-0", "1", "-1", "01", "-01", "00", "123456789", "1234567890",
+    "999999999", "1000000000", "4294967295", "4294967296",
+    "9223372036854775807", "-9223372036854775808", "9223372036854775808",
+    "-9223372036854775809", "99999999999999999999", "1.5", "-1.5", "0.1",
+    "1e3", "1E3", "1e+3", "1e-3", "-1.25e-10", "1.7976931348623157e308",
+    "1e400", "1.", ".5", "1e", "-", "+1", "[1,2,3,4,5,6,7,8,9,10]",
+    "[12345,678901234,5678901234,-12345678]", "{\"bri\":254,\"hue\":65535}",
+    "[1 ,2  ,3   ,4    ]", "{\"a\" : 1 , \"b\"  :  2}",
+    "// comment\n[1]", "/* block */ {\"a\": /* inner */ 1}", "[1 // end\n]",
+    "[1,]", "{\"a\":1,}", "[1 2]", "{\"a\" 1}", "{1:2}", "]", "}", "[", "{",
+    "", " ", "\"\\u0000\"", "[\"a\",\"b\",\"c\"]",
+};
+
+static void* alloc(size_t size, int zero, void* userData)
+{
+    return zero ? calloc(1, size) : malloc(size);
+}
+
+
+static void release(void* ptr, void* userData)
+{
+    free(ptr);
+}
+
+
+static uint32_t numCases = 0;
+static uint32_t numFailures = 0;
+
+
+static bool same(const json_value* a, const json_value* b)
+{
+    if(a->type != b->type) return false;
+
+    switch(a->type)
+    {
+        case json_object:
+        {
+            if(a->u.object.length != b->u.object.length) return false;
+
+            for(uint32_t i = 0; i < a->u.object.length; i++)
+            {
+                const json_object_entry& x = a->u.object.values[i];
+                const json_object_entry& y = b->u.object.values[i];
+
+                if((x.name_length != y.name_length) || 
+                    (memcmp(x.name, y.name, x.name_length + 1) != 0) ||
+                    (same(x.value, y.value) == false)) return false;
+            }
+
+            return true;
+        }
+
+        case json_array:
+        {
+            if(a->u.array.length != b->u.array.length) return false;
+
+            for(uint32_t i = 0; i < a->u.array.length; i++)
+            {
+                if(same(a->u.array.values[i], b->u.array.values[i]) == false) 
+                    return false;
+            }
+
+            return true;
+        }
+
+        case json_integer:
+            return a->u.integer == b->u.integer;
+
+        /* Bit identical, not just equal */
+        case json_double:
+            return memcmp(&a->u.dbl, &b->u.dbl, sizeof(double)) == 0;
+
+        case json_string:
+            return (a->u.string.length == b->u.string.length) && 
+                (memcmp(a->u.string.ptr, b->u.string.ptr, 
+                    a->u.string.length + 1) == 0);
+
+        case json_boolean:
+            return a->u.boolean == b->u.boolean;
+
+        default:
+            return true;
+    }
+}
+
+
+static void check(const std::string& text, size_t length, int settingsFlags, 
+        const char* label)
+{
+    /* Both parsers get their own copy, in situ parsing modifies it */
+    std::vector<char> refBuffer(text.begin(), text.end());
+    std::vector<char> buffer(text.begin(), text.end());
+    refBuffer.push_back('\0');
+    buffer.push_back('\0');
+
+    json_settings refSettings = {};
+    json_settings settings = {};
+    refSettings.settings = settingsFlags;
+    settings.settings = settingsFlags;
+
+    /* The trees of in situ parses are freed with the same settings */
+    refSettings.mem_alloc = settings.mem_alloc = alloc;
+    refSettings.mem_free = settings.mem_free = release;
+
+    char refError[json_error_max] = "";
+    char error[json_error_max] = "";
+
+    json_value* refValue = ref_json_parse_ex(&refSettings, refBuffer.data(), 
+        length, refError);
+    json_value* value = json_parse_ex(&settings, buffer.data(), length, 
+        error);
+
+    bool ok = ((refValue == nullptr) == (value == nullptr)) && 
+        (strcmp(refError, error) == 0) && 
+        ((refValue == nullptr) || same(refValue, value));
+
+    numCases++;
+    if(ok == false)
+    {
+        numFailures++;
+        fprintf(stderr, "FAIL %s: \"%.60s\" (%zu of %zu bytes)\n"
+            "  reference: %s\n  parser:    %s\n", label, text.c_str(), 
+            length, text.size(), refValue ? "ok" : refError, 
+            value ? "ok" : error);
+    }
+
+    ref_json_value_free_ex(&refSettings, refValue);
+    json_value_free_ex(&settings, value);
+}
+
+
+static void checkAll(const std::string& input, bool prefixes)
+{
+    const int flagSets[] = {0, json_enable_comments, json_in_situ, 
+        json_in_situ | json_enable_comments};
+
+    for(int flags : flagSets)
+    {
+        const char* label = (flags & json_in_situ) ? "in situ" : "copied";
+
+        check(input, input.size(), flags, label);
+        if(prefixes == false) continue;
+
+        for(size_t length = 0; length < input.size(); length++)
+            check(input, length, flags, label);
+    }
+}
+
+
+int main(void)
+{
+    /* A parser that loops on some input fails the test instead of 
+     * blocking it */
+    alarm(60);
+
+    for(const char* edgeCase : edgeCases) checkAll(edgeCase, true);
+
+    const uint32_t lampCounts[] = {1, 10, 50};
+    for(uint32_t lamps : lampCounts)
+    {
+        std::string payload = lightsPayload(lamps);
+
+        checkAll(payload, lamps == 1);
+        checkAll(indentPayload(payload), lamps == 1);
+    }
+
+    printf("%u cases, %u failures\n", numCases, numFailures);
+
+    return (numFailures == 0) ? 0 : 1;
+}
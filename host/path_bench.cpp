@@ -0,0 +1,142 @@
+#include "JsonObject.h"
+#include "payloads.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+
+/* Time per field of the lamp state fields, resolved with compile time 
+ * paths against the runtime getters. Both start from a cursor at the 
+ * lamp, as the firmware does when it walks the lamps. */
+
+static const uint32_t repeats = 20000;
+
+static uint8_t arena[512 * 1024] __attribute__((aligned(8)));
+
+static constexpr auto onPath = jsonPath("state", "on");
+static constexpr auto briPath = jsonPath("state", "bri");
+static constexpr auto huePath = jsonPath("state", "hue");
+static constexpr auto reachablePath = jsonPath("state", "reachable");
+static constexpr auto modePath = jsonPath("state", "colormode");
+
+static const char* onKeys[] = {"state", "on"};
+static const char* briKeys[] = {"state", "bri"};
+static const char* hueKeys[] = {"state", "hue"};
+static const char* reachableKeys[] = {"state", "reachable"};
+static const char* modeKeys[] = {"state", "colormode"};
+
+static const uint32_t fieldsPerLamp = 5;
+
+
+static double nanos(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+
+static uint32_t compiledLookups(JsonObject& json, 
+        const std::vector<JsonObject::cursor_t>& lamps)
+{
+    uint32_t found = 0;
+    bool on, reachable;
+    int64_t bri, hue;
+    char* mode;
+
+    for(JsonObject::cursor_t lamp : lamps)
+    {
+        found += json.get(onPath, &on, lamp);
+        found += json.get(briPath, &bri, lamp);
+        found += json.get(huePath, &hue, lamp);
+        found += json.get(reachablePath, &reachable, lamp);
+        found += json.get(modePath, &mode, lamp);
+    }
+
+    return found;
+}
+
+
+static uint32_t runtimeLookups(JsonObject& json, 
+        const std::vector<JsonObject::cursor_t>& lamps)
+{
+    uint32_t found = 0;
+    bool on, reachable;
+    int64_t bri, hue;
+    char* mode;
+
+    for(JsonObject::cursor_t lamp : lamps)
+    {
+        found += json.getBool(onKeys, 2, &on, lamp);
+        found += json.getInt(briKeys, 2, &bri, lamp);
+        found += json.getInt(hueKeys, 2, &hue, lamp);
+        found += json.getBool(reachableKeys, 2, &reachable, lamp);
+        found += json.getString(modeKeys, 2, &mode, lamp);
+    }
+
+    return found;
+}
+
+
+template<typename F>
+static double timePerField(F lookups, uint32_t numLamps)
+{
+    uint32_t found = 0;
+
+    double start = nanos();
+    for(uint32_t i = 0; i < repeats; i++) found += lookups();
+    double elapsed = nanos() - start;
+
+    if(found != repeats * numLamps * fieldsPerLamp)
+    {
+        fprintf(stderr, "Only %u fields found!\n", found);
+        return -1.0;
+    }
+
+    return elapsed / found;
+}
+
+
+int main(void)
+{
+    const uint32_t lampCounts[] = {1, 50};
+
+    printf("%6s %14s %14s\n", "lamps", "compiled ns", "runtime ns");
+
+    for(uint32_t numLamps : lampCounts)
+    {
+        std::string payload = lightsPayload(numLamps);
+        std::vector<char> buffer(payload.begin(), payload.end());
+        buffer.push_back('\0');
+
+        JsonObject json(arena, sizeof(arena));
+        if(json.reparse(buffer.data(), payload.size()) == false) return 1;
+
+        std::vector<JsonObject::cursor_t> lamps;
+        for(uint32_t i = 0; i < numLamps; i++)
+        {
+            std::string id = std::to_string(3 + 4 * i);
+            const char* path[] = {id.c_str()};
+
+            JsonObject::cursor_t lamp;
+            if(json.getCursor(path, 1, &lamp) == false) return 1;
+            lamps.push_back(lamp);
+        }
+
+        double compiled = timePerField(
+            [&]() { return compiledLookups(json, lamps); }, numLamps);
+        double runtime = timePerField(
+            [&]() { return runtimeLookups(json, lamps); }, numLamps);
+
+        if((compiled < 0.0) || (runtime < 0.0)) return 1;
+
+        printf("%6u %14.1f %14.1f\n", numLamps, compiled, runtime);
+    }
+
+    return 0;
+}
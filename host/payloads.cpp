@@ -0,0 +1,207 @@
+#include "payloads.h"
+
+#include <stdio.h>
+
+
+static const char* const lampTypes[] = 
+{
+    "Extended color light",
+    "Dimmable light",
+    "Color temperature light"
+};
+
+
+static uint32_t lampId(uint32_t lamp)
+{
+    return 3 + 4 * lamp;
+}
+
+
+static std::string lamp(uint32_t i)
+{
+    char buffer[1536];
+
+    snprintf(buffer, sizeof(buffer), 
+        "{\"state\": {\"on\": %s, \"bri\": %u, \"hue\": %u, \"sat\": 200, "
+        "\"effect\": \"none\", \"xy\": [0.3, 0.3], \"ct\": 300, "
+        "\"alert\": \"none\", \"colormode\": \"%s\", "
+        "\"mode\": \"homeautomation\", \"reachable\": %s}, "
+        "\"swupdate\": {\"state\": \"noupdates\", "
+        "\"lastinstall\": \"2019-10-10T10:10:10\"}, "
+        "\"type\": \"%s\", \"name\": \"Lamp \\u00e4 %u\", "
+        "\"modelid\": \"LCT015\", "
+        "\"manufacturername\": \"Signify Netherlands B.V.\", "
+        "\"productname\": \"Hue color lamp\", "
+        "\"capabilities\": {\"certified\": true, \"control\": "
+        "{\"mindimlevel\": 1000, \"maxlumen\": 806, "
+        "\"colorgamuttype\": \"C\", \"colorgamut\": [[0.6915, 0.3083], "
+        "[0.17, 0.7], [0.1532, 0.0475]], \"ct\": {\"min\": 153, "
+        "\"max\": 500}}, \"streaming\": {\"renderer\": true, "
+        "\"proxy\": true}}, \"config\": {\"archetype\": \"sultanbulb\", "
+        "\"function\": \"mixed\", \"direction\": \"omnidirectional\", "
+        "\"startup\": {\"mode\": \"safety\", \"configured\": true}}, "
+        "\"uniqueid\": \"00:17:88:01:03:%02x:%02x:%02x-0b\", "
+        "\"swversion\": \"1.50.2_r30933\", \"swconfigid\": \"1234ABCD\", "
+        "\"productid\": \"Philips-LCT015-1-A19ECLv5\"}", 
+        (i % 2 == 0) ? "true" : "false", 100 + i, 1000 * i, 
+        (i % 3 == 0) ? "hs" : "ct", (i % 5 != 4) ? "true" : "false", 
+        lampTypes[i % 3], i, i, i, i);
+
+    return buffer;
+}
+
+
+std::string indentPayload(const std::string& payload)
+{
+    std::string indented;
+    uint32_t depth = 0;
+    bool inString = false;
+    bool escaped = false;
+
+    auto newLine = [&]() { indented += "\r\n" + std::string(4 * depth, ' '); };
+
+    for(char c : payload)
+    {
+        if(inString)
+        {
+            indented += c;
+
+            if(escaped) escaped = false;
+            else if(c == '\\') escaped = true;
+            else if(c == '"') inString = false;
+
+            continue;
+        }
+
+        switch(c)
+        {
+            case '"':
+                inString = true;
+                indented += c;
+                break;
+
+            case '{':
+            case '[':
+                indented += c;
+                depth++;
+                newLine();
+                break;
+
+            case '}':
+            case ']':
+                depth--;
+                newLine();
+                indented += c;
+                break;
+
+            case ',':
+                indented += c;
+                newLine();
+                break;
+
+            case ' ':
+                /* Only the blank after a colon is kept, the line breaks 
+                 * replace the others */
+                if(indented.back() == ':') indented += c;
+                break;
+
+            default:
+                indented += c;
+                break;
+        }
+    }
+
+    return indented;
+}
+
+
+std::string lightsPayload(uint32_t numLamps)
+{
+    std::string payload = "{";
+
+    for(uint32_t i = 0; i < numLamps; i++)
+    {
+        if(i > 0) payload += ", ";
+        payload += "\"" + std::to_string(lampId(i)) + "\": " + lamp(i);
+    }
+
+    return payload + "}";
+}
+
+
+static std::string group(uint32_t g, const char* type, uint32_t firstLamp, 
+        uint32_t numLamps)
+{
+    char buffer[512];
+    std::string json = "{\"name\": \"Group " + std::to_string(g) + 
+        "\", \"lights\": [";
+
+    for(uint32_t i = firstLamp; i < firstLamp + numLamps; i++)
+    {
+        if(i > firstLamp) json += ", ";
+        json += "\"" + std::to_string(lampId(i)) + "\"";
+    }
+
+    snprintf(buffer, sizeof(buffer), 
+        "], \"sensors\": [], \"type\": \"%s\", \"state\": "
+        "{\"all_on\": false, \"any_on\": %s}, \"recycle\": false, "
+        "\"class\": \"Living room\", \"action\": {\"on\": %s, "
+        "\"bri\": %u, \"hue\": 8418, \"sat\": 140, \"effect\": \"none\", "
+        "\"xy\": [0.4573, 0.41], \"ct\": 366, \"alert\": \"select\", "
+        "\"colormode\": \"ct\"}}", type, (g % 2 == 0) ? "false" : "true", 
+        (g % 2 == 0) ? "false" : "true", 100 + g);
+
+    return json + buffer;
+}
+
+
+std::string groupsPayload(uint32_t numLamps)
+{
+    std::string payload = "{";
+    uint32_t g = 1;
+
+    for(uint32_t i = 0; i < numLamps; i += 4, g++)
+    {
+        uint32_t size = (numLamps - i < 4) ? numLamps - i : 4;
+
+        if(g > 1) payload += ", ";
+        payload += "\"" + std::to_string(g) + "\": " + 
+            group(g, "Room", i, size);
+    }
+
+    payload += ", \"" + std::to_string(g) + "\": " + 
+        group(g, "Zone", 0, numLamps);
+
+    return payload + "}";
+}
+
+
+std::string responsesPayload(uint32_t numLamps)
+{
+    std::string payload = "[";
+    char buffer[256];
+
+    for(uint32_t i = 0; i < numLamps; i++)
+    {
+        /* Lamp i is on if i is even, see lamp() */
+        if(i % 2 == 0)
+        {
+            snprintf(buffer, sizeof(buffer), 
+                "{\"success\": {\"/lights/%u/state/bri\": %u}}", 
+                lampId(i), 100 + i);
+        }
+        else
+        {
+            snprintf(buffer, sizeof(buffer), 
+                "{\"error\": {\"type\": 201, "
+                "\"address\": \"/lights/%u/state/bri\", "
+                "\"description\": \"parameter, bri, is not modifiable. "
+                "Device is set to off.\"}}", lampId(i));
+        }
+
+        if(i > 0) payload += ",";
+        payload += buffer;
+    }
+
+    return payload + "]";
+}
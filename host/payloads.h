@@ -0,0 +1,29 @@
+#ifndef PAYLOADS_H
+#define PAYLOADS_H
+
+
+#include <stdint.h>
+
+#include <string>
+
+
+/* Bridge responses shaped like those of a Hue bridge with API 1.3x. Lamp i 
+ * has the bridge ID 3 + 4 * i, and the lamp types cycle through extended 
+ * color, dimmable and color temperature lamps. */
+
+/* GET /lights */
+std::string lightsPayload(uint32_t numLamps);
+
+/* GET /groups, a room per four lamps and a zone with all lamps */
+std::string groupsPayload(uint32_t numLamps);
+
+/* Responses to a brightness change of every lamp, the events the firmware 
+ * streams after its commands. Lamps that are off answer with error 201. */
+std::string responsesPayload(uint32_t numLamps);
+
+/* The payload spread over lines and indented like the bridge's debug 
+ * output, with CR LF line ends */
+std::string indentPayload(const std::string& payload);
+
+
+#endif /* PAYLOADS_H */
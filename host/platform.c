@@ -0,0 +1,25 @@
+#include "esp8266.h"
+
+#include <time.h>
+
+
+/* Time base of the firmware, from the monotonic clock of the host */
+static uint64_t nanos(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+
+uint32_t micros(void)
+{
+    return nanos() / 1000;
+}
+
+
+uint32_t millis(void)
+{
+    return nanos() / 1000000;
+}
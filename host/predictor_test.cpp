@@ -0,0 +1,136 @@
+#include "SliderFilter.h"
+#include "SliderPredictor.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/* The slider predictor behind the filter on synthetic gestures, at the
+ * default tracking rate and prediction lead. A value reaches the lamps
+ * one network delay after it was sampled, it is compared with where the
+ * hand is by then. Prediction must cut that error on every gesture,
+ * overshoot little and end on the exact value once the slider is held. */
+
+static const uint32_t rate = 250;
+static const uint32_t lead = 150;           /* ms, also the network delay */
+static const uint32_t seeds = 5;
+static const int32_t noise = 3;
+
+static const double maxOvershoot = 20.0;    /* ADC steps */
+static const double maxFinalError = 3.0;
+
+
+/* A move from one position to another with an ease in and out, between
+ * the start and the end time in ms, in a trace of 1 s more */
+struct gesture_s
+{
+    const char* name;
+    double from;
+    double to;
+    uint32_t start;
+    uint32_t end;
+};
+
+static const gesture_s gestures[] =
+{
+    {"sweep up",    100, 900, 500, 1500},
+    {"sweep down",  900, 100, 500, 1500},
+    {"flick",       200, 800, 500, 800},
+    {"slow drag",   300, 600, 500, 3500},
+};
+
+struct result_s
+{
+    double meanError;       /* while the hand moves */
+    double overshoot;
+    double finalError;
+};
+
+
+static double hand(const gesture_s& gesture, double t)
+{
+    if(t <= gesture.start) return gesture.from;
+    if(t >= gesture.end) return gesture.to;
+
+    double u = (t - gesture.start) / (gesture.end - gesture.start);
+
+    return gesture.from +
+        (gesture.to - gesture.from) * (0.5 - 0.5 * cos(M_PI * u));
+}
+
+
+static result_s replay(const gesture_s& gesture, uint32_t leadTime,
+        uint32_t seed)
+{
+    SliderFilter filter(rate);
+    SliderPredictor predictor(rate / SliderFilter::DECIMATION);
+    result_s result = {0.0, 0.0, 0.0};
+    double errorSum = 0.0;
+    uint32_t numErrors = 0;
+    uint16_t value = 0;
+    double direction = (gesture.to > gesture.from) ? 1.0 : -1.0;
+
+    srand(seed);
+
+    for(uint32_t t = 0; t < gesture.end + 1000; t += 1000 / rate)
+    {
+        int32_t sample = (int32_t)(hand(gesture, t) + 0.5) +
+            (rand() % (2 * noise + 1)) - noise;
+
+        if(filter.addSample(sample, &value) == false) continue;
+
+        value = predictor.update(value, leadTime);
+
+        /* Where the hand is when the value arrives */
+        double arrival = t + lead;
+        if((arrival > gesture.start) && (arrival < gesture.end))
+        {
+            errorSum += fabs(hand(gesture, arrival) - value);
+            numErrors++;
+        }
+
+        double over = direction * (value - gesture.to);
+        if(over > result.overshoot) result.overshoot = over;
+    }
+
+    result.meanError = errorSum / numErrors;
+    result.finalError = fabs(value - gesture.to);
+
+    return result;
+}
+
+
+int main(void)
+{
+    uint32_t failures = 0;
+
+    for(const gesture_s& gesture : gestures)
+    {
+        for(uint32_t seed = 1; seed <= seeds; seed++)
+        {
+            result_s exact = replay(gesture, 0, seed);
+            result_s predicted = replay(gesture, lead, seed);
+
+            bool ok = (predicted.meanError < exact.meanError) &&
+                (predicted.overshoot <= maxOvershoot) &&
+                (predicted.finalError <= maxFinalError);
+
+            if((ok == false) || (seed == 1))
+            {
+                printf("%s%-10s seed %u: error %.1f -> %.1f steps, "
+                    "overshoot %.1f, final error %.1f\n", ok ? "" : "FAIL ",
+                    gesture.name, seed, exact.meanError,
+                    predicted.meanError, predicted.overshoot,
+                    predicted.finalError);
+            }
+
+            if(ok == false) failures++;
+        }
+    }
+
+    printf("%u gestures, %u seeds, %u failures\n",
+        (uint32_t)(sizeof(gestures) / sizeof(gestures[0])), seeds, failures);
+
+    return (failures == 0) ? 0 : 1;
+}
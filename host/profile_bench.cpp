@@ -0,0 +1,165 @@
+#include "JsonObject.h"
+#include "payloads.h"
+
+#include <stdio.h>
+
+#include <string>
+
+
+/* The firmware's JSON profile on generated bridge payloads of 1 to 63
+ * lamps. JsonObject is built with CONFIG_JSON_PROFILE for this benchmark
+ * only. Each payload is parsed into a tree as the firmware does with a
+ * reply, through the shared arena and the heap once it overflows, and
+ * every lamp, group or response is looked up in it. The results are
+ * written as JSON so runs can be diffed. */
+
+static const uint32_t lampCounts[] = {1, 2, 4, 8, 16, 32, 63};
+
+static const uint32_t minBytes = 4 * 1024 * 1024;
+
+static constexpr auto onPath = jsonPath("state", "on");
+static constexpr auto briPath = jsonPath("state", "bri");
+static constexpr auto reachablePath = jsonPath("state", "reachable");
+static constexpr auto typePath = jsonPath("type");
+
+static constexpr auto firstLampPath = jsonPath("lights", "0");
+static constexpr auto anyOnPath = jsonPath("state", "any_on");
+static constexpr auto actionOnPath = jsonPath("action", "on");
+
+static constexpr auto successPath = jsonPath("success");
+static constexpr auto errorTypePath = jsonPath("error", "type");
+
+
+typedef uint32_t (*lookups_t)(JsonObject& json, uint32_t numLamps);
+
+
+static uint32_t lampLookups(JsonObject& json, uint32_t numLamps)
+{
+    uint32_t found = 0;
+    bool on, reachable;
+    int64_t bri;
+    char* type;
+
+    for(uint32_t i = 0; i < numLamps; i++)
+    {
+        std::string id = std::to_string(3 + 4 * i);
+        const char* key = id.c_str();
+        JsonObject::cursor_t lamp;
+
+        if(json.getCursor(&key, 1, &lamp) == false) continue;
+
+        found += json.get(onPath, &on, lamp);
+        found += json.get(briPath, &bri, lamp);
+        found += json.get(reachablePath, &reachable, lamp);
+        found += json.get(typePath, &type, lamp);
+    }
+
+    return found;
+}
+
+
+static uint32_t groupLookups(JsonObject& json, uint32_t numLamps)
+{
+    uint32_t found = 0;
+    bool anyOn, actionOn;
+    char* firstLamp;
+
+    for(uint32_t g = 1; g <= (numLamps + 3) / 4 + 1; g++)
+    {
+        std::string id = std::to_string(g);
+        const char* key = id.c_str();
+        JsonObject::cursor_t group;
+
+        if(json.getCursor(&key, 1, &group) == false) continue;
+
+        found += json.get(firstLampPath, &firstLamp, group);
+        found += json.get(anyOnPath, &anyOn, group);
+        found += json.get(actionOnPath, &actionOn, group);
+    }
+
+    return found;
+}
+
+
+static uint32_t responseLookups(JsonObject& json, uint32_t numLamps)
+{
+    uint32_t found = 0;
+    int64_t errorType;
+
+    for(uint32_t i = 0; i < numLamps; i++)
+    {
+        std::string index = std::to_string(i);
+        const char* key = index.c_str();
+        JsonObject::cursor_t response, success;
+
+        if(json.getCursor(&key, 1, &response) == false) continue;
+
+        if(json.getCursor(successPath, &success, response)) found++;
+        else found += json.get(errorTypePath, &errorType, response);
+    }
+
+    return found;
+}
+
+
+static bool profile(const char* name, const std::string& payload,
+        uint32_t numLamps, lookups_t lookups, uint32_t expected, bool last)
+{
+    uint32_t repeats = minBytes / payload.size() + 1;
+    uint32_t found = 0;
+
+    JsonObject::resetProfile();
+
+    for(uint32_t r = 0; r < repeats; r++)
+    {
+        JsonObject json(payload.c_str());
+        found += lookups(json, numLamps);
+    }
+
+    if(found != expected * repeats)
+    {
+        fprintf(stderr, "%s with %u lamps: %u of %u lookups found\n", name,
+            numLamps, found, expected * repeats);
+        return false;
+    }
+
+    const JsonObject::profile_s& p = JsonObject::profile();
+
+    printf("  {\"payload\": \"%s\", \"lamps\": %u, \"bytes\": %zu, "
+        "\"parses\": %u, \"parse_us\": %.2f, \"arena_allocs\": %.1f, "
+        "\"heap_allocs\": %.1f, \"heap_peak\": %u, \"lookups\": %u, "
+        "\"lookup_ns\": %.1f}%s\n", name, numLamps, payload.size(),
+        p.parses, (double)p.parseMicros / p.parses,
+        (double)p.arenaAllocs / p.parses, (double)p.heapAllocs / p.parses,
+        p.heapPeak, p.lookups, 1000.0 * p.lookupMicros / p.lookups,
+        last ? "" : ",");
+
+    return true;
+}
+
+
+int main(void)
+{
+    const uint32_t numCounts = sizeof(lampCounts) / sizeof(lampCounts[0]);
+    bool ok = true;
+
+    printf("{\"results\": [\n");
+
+    for(uint32_t c = 0; c < numCounts; c++)
+    {
+        uint32_t n = lampCounts[c];
+        uint32_t groups = (n + 3) / 4 + 1;
+        bool last = (c == numCounts - 1);
+
+        ok &= profile("lights", lightsPayload(n), n, lampLookups,
+            4 * n, false);
+        ok &= profile("groups", groupsPayload(n), n, groupLookups,
+            3 * groups, false);
+        ok &= profile("responses", responsesPayload(n), n, responseLookups,
+            n, last);
+    }
+
+    printf("], \"arena_high_water\": %u}\n", JsonObject::arenaHighWater());
+
+    return ok ? 0 : 1;
+}
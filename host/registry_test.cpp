@@ -0,0 +1,115 @@
+#include "LampRegistry.h"
+
+#include <stdio.h>
+
+
+/* The lamp registry with the bridge IDs it meets in practice: sparse IDs
+ * up to 255, a full table of 64 lamps and the mapping between slots and
+ * IDs both ways. */
+
+static uint32_t failures = 0;
+
+
+static void check(bool condition, const char* what)
+{
+    if(condition) return;
+
+    printf("FAIL %s\n", what);
+    failures++;
+}
+
+
+static void sparseIds(void)
+{
+    static const uint8_t ids[] = {200, 7, 255, 64, 1, 128};
+    static const uint32_t numIds = sizeof(ids) / sizeof(ids[0]);
+
+    LampRegistry lamps;
+
+    for(uint32_t i = 0; i < numIds; i++)
+    {
+        check(lamps.add(ids[i]) == (int32_t)i, "lamps get the next slot");
+    }
+
+    check(lamps.size() == numIds, "all lamps are registered");
+    check(lamps.all() == LAMP_RANGE(0, numIds - 1), "mask of all lamps");
+
+    for(uint32_t i = 0; i < numIds; i++)
+    {
+        check(lamps.slot(ids[i]) == (int32_t)i, "ID to slot");
+        check(lamps.id(i) == ids[i], "slot to ID");
+    }
+
+    check(lamps.add(64) == 3, "a known lamp keeps its slot");
+    check(lamps.size() == numIds, "a known lamp is not added again");
+
+    check(lamps.slot(2) < 0, "unknown ID has no slot");
+    check(lamps.slot(256) < 0, "ID out of range has no slot");
+    check(lamps.add(256) < 0, "ID out of range is refused");
+
+    static const uint8_t combo[] = {255, 0, 128, 9, 64, 0};
+    check(lamps.fromIds(combo, sizeof(combo)) ==
+        (LAMP(2) | LAMP(5) | LAMP(3)),
+        "IDs above 63 resolve, unknown IDs and 0 are skipped");
+    check(lamps.fromIds(combo, 0) == 0, "an empty list has no lamps");
+
+    lamps.setOn(LAMP(1) | LAMP(40), true);
+    check(lamps.on() == LAMP(1), "only registered lamps are switched on");
+
+    lamps.setReachable(LAMPS_ALL, true);
+    check(lamps.reachable() == lamps.all(), "only registered lamps reach");
+
+    lamps.clear();
+    check((lamps.size() == 0) && (lamps.all() == 0) && (lamps.on() == 0),
+        "clear empties the registry");
+    check(lamps.slot(200) < 0, "clear forgets the IDs");
+    check(lamps.add(255) == 0, "slots start over after clear");
+}
+
+
+static void fullTable(void)
+{
+    LampRegistry lamps;
+    uint8_t ids[LampRegistry::MAX_LAMPS];
+
+    /* The highest IDs, in descending order */
+    for(uint32_t i = 0; i < LampRegistry::MAX_LAMPS; i++)
+    {
+        ids[i] = LampRegistry::MAX_LAMP_ID - i;
+        check(lamps.add(ids[i]) == (int32_t)i, "full table slot");
+    }
+
+    check(lamps.size() == LampRegistry::MAX_LAMPS, "table is full");
+    check(lamps.all() == LAMPS_ALL, "all slots are used");
+    check(lamps.add(1) < 0, "a full table refuses a new lamp");
+    check(lamps.add(ids[10]) == 10, "a full table finds a known lamp");
+
+    bool roundTrip = true;
+    for(uint32_t slot = 0; slot < LampRegistry::MAX_LAMPS; slot++)
+    {
+        roundTrip = roundTrip && (lamps.slot(lamps.id(slot)) == (int32_t)slot);
+    }
+    check(roundTrip, "slot to ID to slot in a full table");
+
+    for(uint32_t lampId = 0; lampId <= LampRegistry::MAX_LAMP_ID; lampId++)
+    {
+        int32_t slot = lamps.slot(lampId);
+        if(slot >= 0) roundTrip = roundTrip && (lamps.id(slot) == lampId);
+    }
+    check(roundTrip, "ID to slot to ID in a full table");
+
+    check(lamps.fromIds(ids, LampRegistry::MAX_LAMPS) == LAMPS_ALL,
+        "all IDs resolve to all slots");
+    check(lamps.fromIds(ids + 63, 1) == LAMP(63), "the last slot resolves");
+}
+
+
+int main(void)
+{
+    sparseIds();
+    fullTable();
+
+    printf("%u failures\n", failures);
+
+    return (failures == 0) ? 0 : 1;
+}
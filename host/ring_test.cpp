@@ -0,0 +1,199 @@
+#include "EventRing.h"
+
+#include <stdio.h>
+
+
+/* The event ring, including the races of a producer and a consumer that
+ * preempt each other as the ADC and input tasks do on the device. Items
+ * copy themselves in two halves and can run the other side in between,
+ * so a race happens at a known point instead of by chance. */
+
+struct item_s
+{
+    static const uint32_t numWords = 8;
+
+    uint32_t words[numWords];
+
+    /* Runs once in the middle of the next copy */
+    static void (*preempt)(void);
+
+    item_s(uint32_t value = 0)
+    {
+        for(uint32_t& word : words) word = value;
+    }
+
+    item_s& operator=(const item_s& other)
+    {
+        for(uint32_t i = 0; i < numWords / 2; i++) words[i] = other.words[i];
+
+        if(preempt != nullptr)
+        {
+            void (*run)(void) = preempt;
+            preempt = nullptr;
+            run();
+        }
+
+        for(uint32_t i = numWords / 2; i < numWords; i++)
+            words[i] = other.words[i];
+
+        return *this;
+    }
+
+    bool intact(void) const
+    {
+        for(uint32_t word : words)
+        {
+            if(word != words[0]) return false;
+        }
+
+        return true;
+    }
+};
+
+void (*item_s::preempt)(void) = nullptr;
+
+static EventRing<item_s, 4>* ring;
+static item_s popped;
+static bool poppedAny;
+
+static uint32_t failures = 0;
+
+
+static void check(bool condition, const char* what)
+{
+    if(condition) return;
+
+    printf("FAIL %s\n", what);
+    failures++;
+}
+
+
+static void consumer(void)
+{
+    poppedAny = ring->pop(&popped);
+}
+
+
+static void producer(void)
+{
+    ring->pushOverwrite(item_s(5));
+}
+
+
+static void sequential(void)
+{
+    EventRing<uint32_t, 8> overwriting;
+    uint32_t value, expected = 12;
+
+    for(uint32_t i = 0; i < 20; i++) overwriting.pushOverwrite(i);
+
+    while(overwriting.pop(&value))
+    {
+        check(value == expected++, "overwritten ring keeps the newest items");
+    }
+
+    check(expected == 20, "overwritten ring is read completely");
+    check(overwriting.overrun() == 12, "overwritten items are counted");
+    check(overwriting.peak() == 8, "peak of an overwritten ring");
+
+    /* A full ring is read completely while nothing writes to it */
+    EventRing<uint32_t, 4> refusing;
+    uint32_t pushed = 0;
+
+    for(uint32_t i = 0; i < 6; i++) pushed += refusing.push(i);
+
+    check(pushed == 4, "full ring refuses items");
+    check(refusing.rejected() == 2, "refused items are counted");
+
+    expected = 0;
+    while(refusing.pop(&value))
+    {
+        check(value == expected++, "full ring keeps its order");
+    }
+
+    check(expected == 4, "full ring is read completely");
+}
+
+
+/* The consumer runs while the producer is half way through overwriting
+ * the oldest item of a full ring, the item the consumer reads next */
+static void consumerPreemptsWrite(void)
+{
+    EventRing<item_s, 4> full;
+    ring = &full;
+
+    for(uint32_t i = 1; i <= 4; i++) full.pushOverwrite(item_s(i));
+
+    item_s::preempt = consumer;
+    full.pushOverwrite(item_s(5));
+
+    check(poppedAny, "an item is read during a write");
+    check(popped.intact(), "no torn item during a write");
+    check(popped.words[0] == 2, "the item being written is skipped");
+    check(full.overrun() == 1, "the item being written is counted");
+
+    item_s item;
+    uint32_t expected = 3;
+
+    while(full.pop(&item))
+    {
+        check(item.intact() && (item.words[0] == expected++),
+            "the rest follows in order");
+    }
+
+    check(expected == 6, "the new item is read");
+}
+
+
+/* The producer overwrites the slot the consumer is half way through */
+static void producerPreemptsRead(void)
+{
+    EventRing<item_s, 4> full;
+    ring = &full;
+
+    for(uint32_t i = 1; i <= 4; i++) full.pushOverwrite(item_s(i));
+
+    item_s item;
+    item_s::preempt = producer;
+
+    check(full.pop(&item), "an item is read across a write");
+    check(item.intact(), "no torn item across a write");
+    check(item.words[0] == 2, "the overwritten item is skipped");
+    check(full.overrun() == 1, "the overwritten item is counted");
+}
+
+
+/* A full ring that refuses items must not lose one to a pop, the stricter 
+ * check of a ring that is being written must not apply to it */
+static void fullRefusingRing(void)
+{
+    EventRing<item_s, 4> full;
+    item_s item;
+    uint32_t expected = 1;
+
+    for(uint32_t i = 1; i <= 4; i++) full.push(item_s(i));
+
+    check(full.push(item_s(5)) == false, "full ring refuses an item");
+
+    while(full.pop(&item))
+    {
+        check(item.intact() && (item.words[0] == expected++),
+            "refusing ring keeps all items");
+    }
+
+    check(expected == 5, "refusing ring is read completely");
+    check(full.overrun() == 0, "refusing ring has no overrun");
+}
+
+
+int main(void)
+{
+    sequential();
+    consumerPreemptsWrite();
+    producerPreemptsRead();
+    fullRefusingRing();
+
+    printf("%u failures\n", failures);
+
+    return (failures == 0) ? 0 : 1;
+}
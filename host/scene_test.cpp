@@ -0,0 +1,768 @@
+#include "App.h"
+#include "esp8266.h"
+#include "Trace.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* The bridge scenes of the lamp combinations against a stubbed bridge:
+ * scenes are created once, recalled with a single request, follow a new
+ * look by writing only the light states that differ and are replaced when
+ * the lamps of a combination change. The bridge answers from memory and
+ * counts the requests per kind. */
+
+static const uint32_t maxScenes = 8;
+static const uint32_t numLampIds = LampRegistry::MAX_LAMP_ID + 1;
+
+/* Fields of a light state, negative ones are not stored */
+struct lightstate_s
+{
+    int32_t on;
+    int32_t bri;
+    int32_t hue;
+    int32_t sat;
+    int32_t ct;
+};
+
+struct bridgeScene_s
+{
+    bool used;
+    char id[16];
+    char name[40];
+    char data[32];
+    bool stored[numLampIds];
+    lightstate_s states[numLampIds];
+};
+
+struct bridge_s
+{
+    bridgeScene_s scenes[maxScenes];
+    uint32_t nextId;
+
+    /* Error type returned for a DELETE, 0 to delete */
+    int64_t deleteError;
+
+    uint32_t gets;
+    uint32_t posts;
+    uint32_t deletes;
+    uint32_t lightstatePuts;
+    uint32_t recalls;
+    uint32_t lampPuts;
+    uint32_t groupPuts;
+    char recalled[32];
+};
+
+/* Request body as far as the bridge looks at it */
+struct body_s
+{
+    char name[40];
+    char data[32];
+    char scene[32];
+    lightstate_s state;
+    bool stored[numLampIds];
+    lightstate_s states[numLampIds];
+};
+
+static bridge_s bridge;
+
+static char response[8192];
+static uint32_t responseLen;
+
+static uint32_t failures = 0;
+
+
+static void check(bool condition, const char* what)
+{
+    if(condition) return;
+
+    printf("FAIL %s\n", what);
+    failures++;
+}
+
+
+static void respond(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    responseLen += vsnprintf(response + responseLen,
+        sizeof(response) - responseLen, format, args);
+    va_end(args);
+}
+
+
+static const lightstate_s noState = {-1, -1, -1, -1, -1};
+
+
+static bool setField(lightstate_s& state, JsonStream& stream,
+        const char* field)
+{
+    int64_t number;
+    bool flag;
+
+    if(strcmp(field, "on") == 0)
+    {
+        if(stream.getBool(&flag) == false) return false;
+        state.on = flag;
+        return true;
+    }
+
+    if(stream.getInt(&number) == false) return false;
+
+    if(strcmp(field, "bri") == 0) state.bri = number;
+    else if(strcmp(field, "hue") == 0) state.hue = number;
+    else if(strcmp(field, "sat") == 0) state.sat = number;
+    else if(strcmp(field, "ct") == 0) state.ct = number;
+    else return false;
+
+    return true;
+}
+
+
+static void bodyEvent(JsonStream& stream, JsonStream::event_e event,
+        void* context)
+{
+    body_s& body = *(body_s*)context;
+
+    if(event != JsonStream::EVENT_VALUE) return;
+
+    if(stream.depth() == 1)
+    {
+        if(stream.keyIs(0, "name"))
+            snprintf(body.name, sizeof(body.name), "%s", stream.value());
+        else if(stream.keyIs(0, "scene"))
+            snprintf(body.scene, sizeof(body.scene), "%s", stream.value());
+        else setField(body.state, stream, stream.key(0));
+    }
+    else if((stream.depth() == 2) && stream.keyIs(0, "appdata") &&
+        stream.keyIs(1, "data"))
+    {
+        snprintf(body.data, sizeof(body.data), "%s", stream.value());
+    }
+    else if((stream.depth() == 3) && stream.keyIs(0, "lightstates"))
+    {
+        uint32_t lampId = strtoul(stream.key(1), nullptr, 10);
+        if(lampId >= numLampIds) return;
+
+        if(body.stored[lampId] == false) body.states[lampId] = noState;
+        body.stored[lampId] = true;
+        setField(body.states[lampId], stream, stream.key(2));
+    }
+}
+
+
+static bridgeScene_s* findScene(const char* id, uint32_t idLen)
+{
+    for(bridgeScene_s& scene : bridge.scenes)
+    {
+        if(scene.used && (strlen(scene.id) == idLen) &&
+            (strncmp(scene.id, id, idLen) == 0)) return &scene;
+    }
+
+    return nullptr;
+}
+
+
+static void respondState(const lightstate_s& state)
+{
+    respond("{\"on\": %s", state.on ? "true" : "false");
+    if(state.bri >= 0) respond(", \"bri\": %d", state.bri);
+    if(state.hue >= 0) respond(", \"hue\": %d", state.hue);
+    if(state.sat >= 0) respond(", \"sat\": %d", state.sat);
+    if(state.ct >= 0) respond(", \"ct\": %d", state.ct);
+    respond("}");
+}
+
+
+static void respondScene(const bridgeScene_s& scene, bool lightstates)
+{
+    respond("{\"name\": \"%s\", \"type\": \"LightScene\", \"lights\": [",
+        scene.name);
+
+    const char* separator = "";
+    for(uint32_t lampId = 0; lampId < numLampIds; lampId++)
+    {
+        if(scene.stored[lampId] == false) continue;
+
+        respond("%s\"%u\"", separator, lampId);
+        separator = ", ";
+    }
+
+    respond("], \"recycle\": false, \"appdata\": {\"version\": 1, "
+        "\"data\": \"%s\"}", scene.data);
+
+    if(lightstates)
+    {
+        respond(", \"lightstates\": {");
+
+        separator = "";
+        for(uint32_t lampId = 0; lampId < numLampIds; lampId++)
+        {
+            if(scene.stored[lampId] == false) continue;
+
+            respond("%s\"%u\": ", separator, lampId);
+            respondState(scene.states[lampId]);
+            separator = ", ";
+        }
+
+        respond("}");
+    }
+
+    respond("}");
+}
+
+
+static void respondError(int64_t type, const char* address)
+{
+    respond("[{\"error\": {\"type\": %d, \"address\": \"%s\", "
+        "\"description\": \"stubbed error\"}}]", (int32_t)type, address);
+}
+
+
+/* Answers a request of RequestGenerator into response */
+static void handleRequest(const char* request, uint32_t requestLen)
+{
+    char method[8], url[160];
+    responseLen = 0;
+
+    respond("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n");
+
+    if(sscanf(request, "%7s %159s", method, url) != 2)
+    {
+        respondError(2, "/");
+        return;
+    }
+
+    /* The resource follows the user name */
+    const char* path = strstr(url, "/api/");
+    path = path ? strchr(path + 5, '/') : nullptr;
+    if(path == nullptr)
+    {
+        respondError(1, url);
+        return;
+    }
+    path++;
+
+    static body_s body;
+    memset(&body, 0, sizeof(body));
+    body.state = noState;
+
+    const char* content = strstr(request, "\r\n\r\n");
+    if(content != nullptr)
+    {
+        JsonStream stream(bodyEvent, &body);
+        stream.feed(content + 4, request + requestLen - content - 4);
+    }
+
+    const char* sceneId = (strncmp(path, "scenes/", 7) == 0) ? path + 7 :
+        nullptr;
+    uint32_t sceneIdLen = sceneId ? strcspn(sceneId, "/") : 0;
+    bridgeScene_s* scene = sceneId ? findScene(sceneId, sceneIdLen) : nullptr;
+
+    if((strcmp(method, "GET") == 0) && (strcmp(path, "scenes") == 0))
+    {
+        bridge.gets++;
+
+        respond("{");
+        const char* separator = "";
+        for(const bridgeScene_s& stored : bridge.scenes)
+        {
+            if(stored.used == false) continue;
+
+            respond("%s\"%s\": ", separator, stored.id);
+            respondScene(stored, false);
+            separator = ", ";
+        }
+        respond("}");
+    }
+    else if((strcmp(method, "GET") == 0) && sceneId)
+    {
+        bridge.gets++;
+
+        if(scene) respondScene(*scene, true);
+        else respondError(3, path);
+    }
+    else if((strcmp(method, "POST") == 0) && (strcmp(path, "scenes") == 0))
+    {
+        bridge.posts++;
+
+        bridgeScene_s* free = nullptr;
+        for(bridgeScene_s& stored : bridge.scenes)
+        {
+            if(stored.used == false) free = &stored;
+        }
+
+        if(free == nullptr)
+        {
+            respondError(301, "/scenes");
+            return;
+        }
+
+        free->used = true;
+        snprintf(free->id, sizeof(free->id), "scene%u", bridge.nextId++);
+        strcpy(free->name, body.name);
+        strcpy(free->data, body.data);
+        memcpy(free->stored, body.stored, sizeof(free->stored));
+        memcpy(free->states, body.states, sizeof(free->states));
+
+        respond("[{\"success\": {\"id\": \"%s\"}}]", free->id);
+    }
+    else if((strcmp(method, "DELETE") == 0) && sceneId)
+    {
+        bridge.deletes++;
+
+        if(bridge.deleteError != 0)
+        {
+            respondError(bridge.deleteError, path);
+        }
+        else if(scene == nullptr)
+        {
+            respondError(3, path);
+        }
+        else
+        {
+            scene->used = false;
+            respond("[{\"success\": \"/%s deleted\"}]", path);
+        }
+    }
+    else if((strcmp(method, "PUT") == 0) && sceneId &&
+        strstr(sceneId, "/lightstates/"))
+    {
+        bridge.lightstatePuts++;
+
+        uint32_t lampId = strtoul(strstr(sceneId, "/lightstates/") + 13,
+            nullptr, 10);
+
+        if((scene == nullptr) || (lampId >= numLampIds) ||
+            (scene->stored[lampId] == false))
+        {
+            respondError(3, path);
+            return;
+        }
+
+        lightstate_s& state = scene->states[lampId];
+        if(body.state.on >= 0) state.on = body.state.on;
+        if(body.state.bri >= 0) state.bri = body.state.bri;
+        if(body.state.hue >= 0) state.hue = body.state.hue;
+        if(body.state.sat >= 0) state.sat = body.state.sat;
+        if(body.state.ct >= 0) state.ct = body.state.ct;
+
+        respond("[{\"success\": {\"/%s/on\": %s}}]", path,
+            state.on ? "true" : "false");
+    }
+    else if((strcmp(method, "PUT") == 0) &&
+        (strcmp(path, "groups/0/action") == 0) && body.scene[0])
+    {
+        bridge.recalls++;
+        strcpy(bridge.recalled, body.scene);
+
+        respond("[{\"success\": {\"/groups/0/action/scene\": \"%s\"}}]",
+            body.scene);
+    }
+    else if((strcmp(method, "PUT") == 0) && (strncmp(path, "groups/", 7) == 0))
+    {
+        bridge.groupPuts++;
+        respond("[{\"success\": {\"/%s/on\": true}}]", path);
+    }
+    else if((strcmp(method, "PUT") == 0) && (strncmp(path, "lights/", 7) == 0))
+    {
+        bridge.lampPuts++;
+        respond("[{\"success\": {\"/%s/on\": true}}]", path);
+    }
+    else
+    {
+        respondError(4, path);
+    }
+}
+
+
+/* The firmware parts the scene handling does not depend on */
+void wifi_init(void)
+{
+}
+
+
+int32_t wifi_send(const char* sendData, const uint32_t sendDataLen,
+        char* recDataBuffer, uint32_t recDataBufferLen, uint32_t recDelay)
+{
+    handleRequest(sendData, sendDataLen);
+
+    uint32_t len = (responseLen < recDataBufferLen) ? responseLen :
+        recDataBufferLen;
+    memcpy(recDataBuffer, response, len);
+
+    return len;
+}
+
+
+/* Responses are streamed in chunks as small as the buffer allows */
+int32_t wifi_send_stream(const char* sendData, const uint32_t sendDataLen,
+        char* chunkBuffer, uint32_t chunkBufferLen, uint32_t recDelay,
+        wifi_chunk_callback_t callback, void* context)
+{
+    handleRequest(sendData, sendDataLen);
+
+    for(uint32_t pos = 0; pos < responseLen; pos += chunkBufferLen)
+    {
+        uint32_t len = responseLen - pos;
+        if(len > chunkBufferLen) len = chunkBufferLen;
+
+        memcpy(chunkBuffer, response + pos, len);
+        callback(chunkBuffer, len, context);
+    }
+
+    return responseLen;
+}
+
+
+void LedStrip::init(uint8_t brightness) {}
+void LedStrip::showHUE(uint8_t sat) {}
+void LedStrip::showSaturation(uint16_t hue) {}
+void LedStrip::showBrightness(uint16_t hue, uint8_t sat) {}
+void LedStrip::showBrightness(uint16_t ct) {}
+void LedStrip::showColorTemperature(void) {}
+
+void Input::init(void) {}
+void Input::logStats(void) {}
+void Input::setSteps(uint32_t steps, uint32_t hysteresis) {}
+
+extern "C" void trace_mark(trace_stage_t stage) {}
+extern "C" void trace_dump(void) {}
+
+
+static uint32_t numBridgeScenes(void)
+{
+    uint32_t count = 0;
+
+    for(const bridgeScene_s& scene : bridge.scenes) count += scene.used;
+
+    return count;
+}
+
+
+static void resetCounters(void)
+{
+    bridge.gets = 0;
+    bridge.posts = 0;
+    bridge.deletes = 0;
+    bridge.lightstatePuts = 0;
+    bridge.recalls = 0;
+    bridge.lampPuts = 0;
+    bridge.groupPuts = 0;
+}
+
+
+struct SceneTest
+{
+    /* Lamps 1 to 5 of the extended color type, all off. The ceiling lamps
+     * 1 to 3 are switched off by combination 1. */
+    static void setUp(void)
+    {
+        App& app = App::instance();
+
+        memset(&bridge, 0, sizeof(bridge));
+
+        /* A scene of another application */
+        bridgeScene_s& foreign = bridge.scenes[maxScenes - 1];
+        foreign.used = true;
+        strcpy(foreign.id, "foreign");
+        strcpy(foreign.name, "Relax");
+        strcpy(foreign.data, "00000000");
+        foreign.stored[1] = true;
+        foreign.states[1] = {1, 144, -1, -1, 447};
+
+        app.m_Lamps.clear();
+        for(uint32_t lampId = 1; lampId <= 5; lampId++)
+        {
+            int32_t slot = app.m_Lamps.add(lampId);
+            app.m_Lamps.setCaps(slot, App::CAP_ALL);
+        }
+
+        app.m_Lamps.setReachable(app.m_Lamps.all(), true);
+        app.m_Lamps.setOn(app.m_Lamps.all(), false);
+        app.m_NumGroups = 0;
+        app.resolveLampCombos();
+
+        memset(app.m_Scenes, 0, sizeof(app.m_Scenes));
+        app.m_ColorMode = colorMode_e::CT;
+        app.m_Brightness = 120;
+        app.m_CT = 300;
+        app.checkScenes();
+        settle();
+    }
+
+    static void settle(void)
+    {
+        App& app = App::instance();
+        app.m_LookTime = millis() - App::m_SceneQuietTime;
+    }
+
+    static bool ready(int32_t combo)
+    {
+        return App::instance().m_Scenes[combo].state ==
+            App::sceneState_e::READY;
+    }
+
+    static bool inState(int32_t combo, App::sceneState_e state)
+    {
+        return App::instance().m_Scenes[combo].state == state;
+    }
+
+    static const bridgeScene_s* bridgeScene(int32_t combo)
+    {
+        const char* id = App::instance().m_Scenes[combo].id;
+        return findScene(id, strlen(id));
+    }
+
+    /* The scenes are created once, scenes of other applications are left
+     * alone */
+    static void create(void)
+    {
+        App& app = App::instance();
+
+        app.loadScenes();
+
+        check(inState(0, App::sceneState_e::MISSING) &&
+            inState(1, App::sceneState_e::MISSING),
+            "scenes are missing on an empty bridge");
+
+        resetCounters();
+        app.syncScenes();
+
+        check(bridge.posts == 2, "a scene is created per combination");
+        check(ready(0) && ready(1), "created scenes are ready");
+        check(numBridgeScenes() == 3, "the foreign scene is kept");
+
+        const bridgeScene_s* scene = bridgeScene(0);
+        check((scene != nullptr) &&
+            (strcmp(scene->name, "HUE_Controller combo 0") == 0),
+            "scene of combination 0 is stored");
+
+        if(scene == nullptr) return;
+
+        bool allOn = true;
+        for(uint32_t lampId = 1; lampId <= 5; lampId++)
+        {
+            const lightstate_s& state = scene->states[lampId];
+            allOn = allOn && scene->stored[lampId] && (state.on == 1) &&
+                (state.bri == 120) && (state.ct == 300) && (state.hue < 0);
+        }
+        check(allOn, "combination 0 holds the look for all lamps");
+
+        scene = bridgeScene(1);
+        check((scene != nullptr) && scene->stored[1] &&
+            (scene->states[1].on == 0) && (scene->states[1].bri < 0) &&
+            (scene->states[4].on == 1) && (scene->states[4].bri == 120),
+            "combination 1 switches the ceiling lamps off");
+
+        resetCounters();
+        app.syncScenes();
+        check(bridge.gets + bridge.posts + bridge.lightstatePuts == 0,
+            "ready scenes are not touched");
+    }
+
+    /* A combination is reached with a single recall of its scene */
+    static void recall(void)
+    {
+        App& app = App::instance();
+
+        resetCounters();
+        app.m_LampComboMode = 1;
+        app.setLampComboMode();
+
+        check(bridge.recalls == 1, "the scene is recalled");
+        check(strcmp(bridge.recalled, app.m_Scenes[1].id) == 0,
+            "the scene of the combination is recalled");
+        check(bridge.lampPuts + bridge.groupPuts == 0,
+            "no lamp commands with a scene");
+        check(app.m_Lamps.on() ==
+            (LAMP(app.m_Lamps.slot(4)) | LAMP(app.m_Lamps.slot(5))),
+            "the recalled combination is on");
+    }
+
+    /* A new look updates the light states in place once the slider rests,
+     * the scenes keep their IDs */
+    static void newLook(void)
+    {
+        App& app = App::instance();
+
+        char ids[2][sizeof(app.m_Scenes[0].id)];
+        strcpy(ids[0], app.m_Scenes[0].id);
+        strcpy(ids[1], app.m_Scenes[1].id);
+
+        app.m_Brightness = 200;
+        app.checkScenes();
+
+        check(inState(0, App::sceneState_e::UPDATE) &&
+            inState(1, App::sceneState_e::UPDATE),
+            "a new look outdates the scenes");
+        check(app.lookSettled() == false, "a new look is not settled");
+
+        /* An outdated scene is not recalled */
+        resetCounters();
+        app.m_LampComboMode = 0;
+        app.setLampComboMode();
+
+        check(bridge.recalls == 0, "an outdated scene is not recalled");
+        check(bridge.lampPuts + bridge.groupPuts > 0,
+            "lamp commands without a scene");
+
+        /* Back to the look of the scenes before they are updated */
+        app.m_Brightness = 90;
+        app.checkScenes();
+        app.m_Brightness = 120;
+        app.checkScenes();
+
+        check(ready(0) && ready(1), "the look of the scenes returns");
+
+        app.m_Brightness = 200;
+        app.checkScenes();
+        settle();
+
+        resetCounters();
+        app.syncScenes();
+
+        check(bridge.posts + bridge.deletes == 0,
+            "a new look does not replace the scenes");
+        check(bridge.gets == 2, "the light states are read once per scene");
+        check(bridge.lightstatePuts == 7,
+            "only the light states of lamps switched on are written");
+        check(ready(0) && ready(1), "updated scenes are ready");
+        check((strcmp(app.m_Scenes[0].id, ids[0]) == 0) &&
+            (strcmp(app.m_Scenes[1].id, ids[1]) == 0),
+            "updated scenes keep their IDs");
+
+        const bridgeScene_s* scene = bridgeScene(1);
+        check((scene != nullptr) && (scene->states[5].bri == 200) &&
+            (scene->states[1].on == 0) && (scene->states[1].bri < 0),
+            "the light states follow the look");
+    }
+
+    /* After a restart the light states are compared, equal ones are not
+     * written again */
+    static void reload(void)
+    {
+        App& app = App::instance();
+
+        memset(app.m_Scenes, 0, sizeof(app.m_Scenes));
+        resetCounters();
+        app.loadScenes();
+
+        check(inState(0, App::sceneState_e::UPDATE) &&
+            inState(1, App::sceneState_e::UPDATE),
+            "loaded scenes of the same lamps are checked");
+
+        app.syncScenes();
+
+        check(bridge.lightstatePuts + bridge.posts + bridge.deletes == 0,
+            "scenes of the current look are not written");
+        check(ready(0) && ready(1), "checked scenes are ready");
+
+        /* Restarted with another look */
+        memset(app.m_Scenes, 0, sizeof(app.m_Scenes));
+        app.m_ColorMode = colorMode_e::HS;
+        app.m_HUE = 10000;
+        app.m_Saturation = 200;
+        app.checkScenes();
+        settle();
+
+        resetCounters();
+        app.loadScenes();
+        app.syncScenes();
+
+        check(bridge.lightstatePuts == 7,
+            "scenes of another look are written once");
+
+        const bridgeScene_s* scene = bridgeScene(0);
+        check((scene != nullptr) && (scene->states[2].hue == 10000) &&
+            (scene->states[2].sat == 200), "the scene holds the new color");
+
+        resetCounters();
+        memset(app.m_Scenes, 0, sizeof(app.m_Scenes));
+        app.loadScenes();
+        app.syncScenes();
+
+        check(bridge.lightstatePuts == 0, "written light states compare equal");
+    }
+
+    /* A new lamp changes the lamps of the combinations, their scenes are
+     * replaced. The old ones are deleted first and are kept while that
+     * fails. */
+    static void replace(void)
+    {
+        App& app = App::instance();
+
+        char ids[2][sizeof(app.m_Scenes[0].id)];
+        strcpy(ids[0], app.m_Scenes[0].id);
+        strcpy(ids[1], app.m_Scenes[1].id);
+
+        int32_t slot = app.m_Lamps.add(6);
+        app.m_Lamps.setCaps(slot, App::CAP_BRI);
+        app.m_Lamps.setReachable(LAMP(slot), true);
+        app.resolveLampCombos();
+
+        memset(app.m_Scenes, 0, sizeof(app.m_Scenes));
+        app.loadScenes();
+
+        check(inState(0, App::sceneState_e::STALE) &&
+            inState(1, App::sceneState_e::STALE),
+            "scenes of other lamps are stale");
+
+        bridge.deleteError = 901;
+        resetCounters();
+        app.syncScenes();
+
+        check(bridge.deletes == 2, "stale scenes are deleted");
+        check(bridge.posts == 0, "no scene is created while the delete fails");
+        check(inState(0, App::sceneState_e::STALE),
+            "a scene stays stale while the delete fails");
+        check(numBridgeScenes() == 3, "no scene is left behind");
+
+        bridge.deleteError = 0;
+        resetCounters();
+        app.syncScenes();
+
+        check((bridge.deletes == 2) && (bridge.posts == 2),
+            "stale scenes are replaced");
+        check(ready(0) && ready(1), "replaced scenes are ready");
+        check(numBridgeScenes() == 3, "the old scenes are gone");
+        check((findScene(ids[0], strlen(ids[0])) == nullptr) &&
+            (findScene(ids[1], strlen(ids[1])) == nullptr),
+            "the old scene IDs are gone");
+        check(findScene("foreign", 7) != nullptr, "the foreign scene is kept");
+
+        const bridgeScene_s* scene = bridgeScene(0);
+        check((scene != nullptr) && scene->stored[6] &&
+            (scene->states[6].bri >= 0) && (scene->states[6].hue < 0),
+            "the new lamp gets the fields it supports");
+
+        /* A scene that is gone already counts as deleted */
+        const bridgeScene_s* gone = bridgeScene(1);
+        if(gone != nullptr) ((bridgeScene_s*)gone)->used = false;
+        app.m_Scenes[1].state = App::sceneState_e::STALE;
+
+        resetCounters();
+        app.syncScenes();
+
+        check((bridge.posts == 1) && ready(1),
+            "a scene deleted elsewhere is created again");
+        check(numBridgeScenes() == 3, "no scene is left behind");
+    }
+};
+
+
+int main(void)
+{
+    SceneTest::setUp();
+    SceneTest::create();
+    SceneTest::recall();
+    SceneTest::newLook();
+    SceneTest::reload();
+    SceneTest::replace();
+
+    printf("%u failures\n", failures);
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,233 @@
+#include "JsonStream.h"
+#include "payloads.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <string>
+
+
+/* The streaming tokenizer must not depend on where the network splits a
+ * document: every document is fed in two chunks split at every byte and
+ * in three around every byte, the events have to equal those of the
+ * document fed at once. Truncated and malformed documents have to fail instead of
+ * ending in a partial state. */
+
+static uint32_t failures = 0;
+static uint32_t cases = 0;
+
+
+static void check(bool condition, const char* what, const char* document)
+{
+    cases++;
+
+    if(condition) return;
+
+    printf("FAIL %s: %.60s\n", what, document);
+    failures++;
+}
+
+
+/* One line per event with the path, type and value */
+static void logEvent(JsonStream& stream, JsonStream::event_e event,
+        void* context)
+{
+    std::string& log = *(std::string*)context;
+
+    char line[64];
+    snprintf(line, sizeof(line), "%d %u", event, stream.depth());
+    log += line;
+
+    for(uint32_t level = 0; level < stream.depth(); level++)
+    {
+        log += '/';
+        log += stream.key(level);
+    }
+
+    if(event == JsonStream::EVENT_VALUE)
+    {
+        snprintf(line, sizeof(line), " %d%s ", stream.type(),
+            stream.valueTruncated() ? "+" : "");
+        log += line;
+        log += stream.value();
+    }
+
+    log += '\n';
+}
+
+
+/* Feeds the document in chunks that end at the given split points */
+static bool parse(const std::string& document, const uint32_t* splits,
+        uint32_t numSplits, std::string& log, bool* failed)
+{
+    log.clear();
+    JsonStream stream(logEvent, &log);
+
+    uint32_t start = 0;
+    for(uint32_t i = 0; i <= numSplits; i++)
+    {
+        uint32_t end = (i < numSplits) ? splits[i] : document.size();
+        stream.feed(document.data() + start, end - start);
+        start = end;
+    }
+
+    bool done = stream.finish();
+    *failed = stream.failed();
+
+    return done;
+}
+
+
+static void splitAnywhere(const std::string& document)
+{
+    std::string whole, split;
+    bool failed;
+
+    bool done = parse(document, nullptr, 0, whole, &failed);
+    check(done && (failed == false) && (whole.empty() == false),
+        "complete document is parsed", document.c_str());
+
+    bool same = true;
+    for(uint32_t at = 0; at <= document.size(); at++)
+    {
+        same = same && parse(document, &at, 1, split, &failed) &&
+            (split == whole);
+    }
+    check(same, "split at every byte gives the same events",
+        document.c_str());
+
+    /* Three chunks around every byte */
+    same = true;
+    for(uint32_t at = 1; at < document.size(); at++)
+    {
+        uint32_t splits[] = {at - 1, at};
+        same = same && parse(document, splits, 2, split, &failed) &&
+            (split == whole);
+    }
+    check(same, "split around every byte gives the same events",
+        document.c_str());
+}
+
+
+/* Every prefix from the first container to before the last bracket fails */
+static void truncated(const std::string& document)
+{
+    std::string log;
+    bool failed;
+    bool allFail = true;
+
+    uint32_t end = document.find_last_not_of(" \r\n\t");
+
+    for(uint32_t len = document.find_first_of("{["); len < end; len++)
+    {
+        bool done = parse(document.substr(0, len), nullptr, 0, log, &failed);
+        allFail = allFail && (done == false) && failed;
+    }
+
+    check(allFail, "truncated document fails", document.c_str());
+}
+
+
+static void malformed(const char* document)
+{
+    std::string text(document), log;
+    bool failed;
+
+    bool allFail = true;
+    for(uint32_t at = 0; at <= text.size(); at++)
+    {
+        bool done = parse(text, &at, 1, log, &failed);
+        allFail = allFail && (done == false) && failed;
+    }
+
+    check(allFail, "malformed document fails at every split", document);
+}
+
+
+static const char* const documents[] =
+{
+    "{}",
+    "[]",
+    "{\"a\":1}",
+    "[true,false,null,0,-0,12,-3.25,1e5,2E-3,-4.5e+10]",
+    "{\"esc\": \"q\\\"b\\\\s\\/n\\nt\\tu\\u00e9\\uD83D\\ude00\", "
+        "\"k\\\"ey\": \"x\"}",
+    "{\"long\": \"0123456789012345678901234567890123456789\", "
+        "\"number\": 123456789012345678901234567890123456789}",
+    "[[[[[[[[1]]]]]]], {\"a\": {\"b\": {\"c\": {\"d\": {\"e\": {\"f\": "
+        "{\"g\": [true]}}}}}}}]",
+    "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n\r\n"
+        "[{\"success\": {\"/lights/1/state/on\": true}}, "
+        "{\"error\": {\"type\": 201, \"address\": \"/lights/2/state/bri\", "
+        "\"description\": \"parameter, bri, is not modifiable\"}}]",
+    "{ \"1\" : { \"state\" : { \"on\" : true , \"xy\" : [ 0.4573 , 0.41 ] } ,"
+        "\r\n\t\"e\" : [ ] , \"o\" : { } } }",
+};
+
+static const char* const malformedDocuments[] =
+{
+    "{\"a\" 1}",
+    "{\"a\":}",
+    "{\"a\":1,}",
+    "[1,]",
+    "[1 2]",
+    "{\"a\":1]",
+    "[1}",
+    "{\"a\":[}]",
+    "[\"a\":1]",
+    "{a:1}",
+    "{\"a\":tru}",
+    "{\"a\":nul}",
+    "{\"a\":truex}",
+    "{\"a\":1-2}",
+    "{\"a\":01}",
+    "{\"a\":-}",
+    "{\"a\":1.}",
+    "{\"a\":1e}",
+    "{\"a\":.5}",
+    "{\"a\":+1}",
+    "{\"a\":\"\\u12\"}",
+    "{\"a\":\"\\u12g4\"}",
+    "{\"a\":'b'}",
+    "",
+    "no document",
+};
+
+
+int main(void)
+{
+    for(const char* document : documents)
+    {
+        splitAnywhere(document);
+        truncated(document);
+    }
+
+    /* Bridge sized payloads */
+    std::string payloads[] =
+    {
+        lightsPayload(3),
+        indentPayload(groupsPayload(4)),
+        responsesPayload(6)
+    };
+
+    for(const std::string& payload : payloads)
+    {
+        splitAnywhere(payload);
+        truncated(payload);
+    }
+
+    for(const char* document : malformedDocuments) malformed(document);
+
+    /* A failed stream starts over with reset() */
+    std::string log;
+    JsonStream stream(logEvent, &log);
+    stream.feed("{\"a\":tru}", 9);
+    bool failedBefore = stream.failed();
+    stream.reset();
+    stream.feed("{\"a\":true}", 10);
+    check(failedBefore && stream.finish(), "reset after a failure", "");
+
+    printf("%u cases, %u failures\n", cases, failures);
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,19 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+
+#include <stdint.h>
+
+
+typedef uint32_t TickType_t;
+typedef int32_t BaseType_t;
+typedef uint32_t UBaseType_t;
+
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+
+/* The host programs are single threaded */
+#define portENTER_CRITICAL()
+#define portEXIT_CRITICAL()
+
+
+#endif /* FREERTOS_H */
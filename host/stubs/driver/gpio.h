@@ -0,0 +1,62 @@
+#ifndef DRIVER_GPIO_H
+#define DRIVER_GPIO_H
+
+
+#include <stdint.h>
+
+
+typedef int32_t esp_err_t;
+
+#define ESP_ERROR_CHECK(x)  ((void)(x))
+#define BIT(n)              (1UL << (n))
+
+typedef enum
+{
+    GPIO_NUM_5 = 5
+} gpio_num_t;
+
+typedef enum
+{
+    GPIO_MODE_INPUT = 0,
+    GPIO_MODE_OUTPUT
+} gpio_mode_t;
+
+typedef enum
+{
+    GPIO_PULLUP_DISABLE = 0,
+    GPIO_PULLUP_ENABLE
+} gpio_pullup_t;
+
+typedef enum
+{
+    GPIO_PULLDOWN_DISABLE = 0,
+    GPIO_PULLDOWN_ENABLE
+} gpio_pulldown_t;
+
+typedef enum
+{
+    GPIO_INTR_DISABLE = 0
+} gpio_int_type_t;
+
+typedef struct
+{
+    uint32_t pin_bit_mask;
+    gpio_mode_t mode;
+    gpio_pullup_t pull_up_en;
+    gpio_pulldown_t pull_down_en;
+    gpio_int_type_t intr_type;
+} gpio_config_t;
+
+/* The pins of the host programs go nowhere */
+static inline esp_err_t gpio_config(const gpio_config_t* config)
+{
+    return 0;
+}
+
+static inline esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level)
+{
+    return 0;
+}
+
+
+#endif /* DRIVER_GPIO_H */
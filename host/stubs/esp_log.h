@@ -0,0 +1,21 @@
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+
+#include <stdio.h>
+
+
+/* Errors go to stderr. Warnings, info and debug output are compiled but 
+ * dropped so they do not disturb the benchmark results, the arena overflow 
+ * warning would otherwise be printed on every large parse. */
+#define ESP_LOGE(tag, format, ...) \
+    fprintf(stderr, "E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) \
+    do { if(0) printf(format, ##__VA_ARGS__); } while(0)
+#define ESP_LOGI(tag, format, ...) \
+    do { if(0) printf(format, ##__VA_ARGS__); } while(0)
+#define ESP_LOGD(tag, format, ...) \
+    do { if(0) printf(format, ##__VA_ARGS__); } while(0)
+
+
+#endif /* ESP_LOG_H */
@@ -0,0 +1,29 @@
+#ifndef TIMERS_H
+#define TIMERS_H
+
+
+#include "FreeRTOS.h"
+
+
+typedef void* TimerHandle_t;
+typedef void (*TimerCallbackFunction_t)(TimerHandle_t timer);
+
+/* Timers never expire on the host */
+static inline TimerHandle_t xTimerCreate(const char* name, TickType_t period,
+        UBaseType_t autoReload, void* id, TimerCallbackFunction_t callback)
+{
+    return (TimerHandle_t)0;
+}
+
+static inline BaseType_t xTimerStart(TimerHandle_t timer, TickType_t wait)
+{
+    return 1;
+}
+
+static inline BaseType_t xTimerReset(TimerHandle_t timer, TickType_t wait)
+{
+    return 1;
+}
+
+
+#endif /* TIMERS_H */
@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+#
+# Decodes the spans printed by trace_dump() (CONFIG_LATENCY_TRACE) into
+# the latency from input of every stage.
+#
+#   python3 host/trace_decode.py console.log
+#   make monitor | tee console.log
+#
+# The log may hold several dumps and any other output, dumps of the same
+# ring repeat spans and those are counted once. Prints a histogram per
+# stage in power of two ms buckets and the percentiles, or JSON with
+# --json so runs can be compared.
+#
+
+import argparse
+import json
+import re
+import sys
+
+
+STAGES = ["input", "event", "app", "request", "connect", "write",
+          "first_byte", "close", "led"]
+
+# Upper bounds of the buckets in ms, the last one is open
+BUCKETS = [1 << i for i in range(11)]
+
+CLOCK_LINE = re.compile(r"TRACE_CLOCK (\d+)")
+SPAN_LINE = re.compile(r"TRACE (\d+) (\w+) (\d+)")
+
+
+def read_dumps(lines):
+    """Returns the dumps as (clock, [(id, stage, cycles), ...]) in order"""
+    dumps = []
+
+    for line in lines:
+        match = CLOCK_LINE.search(line)
+        if match:
+            dumps.append((int(match.group(1)), []))
+            continue
+
+        match = SPAN_LINE.search(line)
+        if match is None or match.group(2) not in STAGES:
+            continue
+
+        # Spans before the first clock line come from an older firmware
+        # at the default clock
+        if not dumps:
+            dumps.append((80000000, []))
+
+        dumps[-1][1].append((int(match.group(1)), match.group(2),
+                             int(match.group(3))))
+
+    return dumps
+
+
+def latencies(dumps):
+    """Returns the latencies from input in ms per stage. A span counts
+    from the last input of its ID before it, spans whose input has been
+    overwritten in the ring are skipped."""
+    seen = set()
+    result = {stage: [] for stage in STAGES[1:]}
+
+    for clock, spans in dumps:
+        inputs = {}
+
+        for trace_id, stage, cycles in spans:
+            if stage == "input":
+                inputs[trace_id] = cycles
+                continue
+
+            start = inputs.get(trace_id)
+            if start is None:
+                continue
+
+            # Other dumps of the same ring repeat the span
+            key = (trace_id, start, stage, cycles)
+            if key in seen:
+                continue
+            seen.add(key)
+
+            # The cycle counter wraps every 53 s at 80 MHz
+            elapsed = (cycles - start) & 0xFFFFFFFF
+            result[stage].append(elapsed * 1000.0 / clock)
+
+    return result
+
+
+def percentile(values, fraction):
+    index = min(len(values) - 1, int(fraction * len(values)))
+    return sorted(values)[index]
+
+
+def histogram(values):
+    counts = [0] * (len(BUCKETS) + 1)
+
+    for ms in values:
+        bucket = 0
+        while bucket < len(BUCKETS) and ms >= BUCKETS[bucket]:
+            bucket += 1
+        counts[bucket] += 1
+
+    return counts
+
+
+def summary(result):
+    stages = {}
+
+    for stage in STAGES[1:]:
+        values = result[stage]
+        if not values:
+            continue
+
+        stages[stage] = {
+            "count": len(values),
+            "p50_ms": round(percentile(values, 0.50), 2),
+            "p90_ms": round(percentile(values, 0.90), 2),
+            "p99_ms": round(percentile(values, 0.99), 2),
+            "max_ms": round(max(values), 2),
+            "histogram": histogram(values),
+        }
+
+    return stages
+
+
+def print_table(stages):
+    labels = ["<%d" % bound for bound in BUCKETS] + [">=%d" % BUCKETS[-1]]
+
+    print("Latency from input in ms")
+    print("%-10s %6s %8s %8s %8s %8s   %s" % ("stage", "count", "p50", "p90",
+          "p99", "max", " ".join("%5s" % label for label in labels)))
+
+    for stage, s in stages.items():
+        print("%-10s %6d %8.2f %8.2f %8.2f %8.2f   %s" % (stage, s["count"],
+              s["p50_ms"], s["p90_ms"], s["p99_ms"], s["max_ms"],
+              " ".join("%5d" % count for count in s["histogram"])))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decodes latency traces")
+    parser.add_argument("log", nargs="?", help="console log, default stdin")
+    parser.add_argument("--json", action="store_true",
+                        help="print the summary as JSON")
+    args = parser.parse_args()
+
+    if args.log:
+        with open(args.log, errors="replace") as log:
+            dumps = read_dumps(log)
+    else:
+        dumps = read_dumps(sys.stdin)
+
+    if not dumps:
+        sys.exit("No trace spans found")
+
+    stages = summary(latencies(dumps))
+
+    if args.json:
+        print(json.dumps({"dumps": len(dumps),
+                          "bucket_bounds_ms": BUCKETS, "stages": stages}))
+    else:
+        print_table(stages)
+
+
+if __name__ == "__main__":
+    main()
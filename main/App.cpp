@@ -2,12 +2,19 @@
 
 #include "RequestGenerator.h"
 #include "JsonObject.h"
+#include "Lut.h"
+#include "Trace.h"
+#include "esp8266.h"
 
 #include <esp_log.h>
 #include <driver/gpio.h>
 
 #include "task.h"
 
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
 
 #define LOG_TAG     "App"
 
@@ -16,29 +23,228 @@
 #define GPIO_SHUTDOWN   GPIO_NUM_5
 
 
-static const char* numStr[] = 
-        {"0", "1", "2", "3", "4", "5", "6", "7", "8", "9"};
+static constexpr const char* stateStr        = "state";
+static constexpr const char* onStr           = "on";
+static constexpr const char* colormodeStr    = "colormode";
+static constexpr const char* briStr          = "bri";
+static constexpr const char* hueStr          = "hue";
+static constexpr const char* satStr          = "sat";
+static constexpr const char* ctStr           = "ct";
+static constexpr const char* lightsStr       = "lights";
+static constexpr const char* nameStr         = "name";
+static constexpr const char* appdataStr      = "appdata";
+static constexpr const char* dataStr         = "data";
+static constexpr const char* successStr      = "success";
+static constexpr const char* idStr           = "id";
+static constexpr const char* typeStr         = "type";
+static constexpr const char* capabilitiesStr = "capabilities";
+static constexpr const char* controlStr      = "control";
+static constexpr const char* colorgamutStr   = "colorgamut";
+static constexpr const char* reachableStr    = "reachable";
+static constexpr const char* errorStr        = "error";
+static constexpr const char* lightstatesStr  = "lightstates";
+
+/* Paths into single lamp and scene creation replies */
+static constexpr auto statePath     = jsonPath(stateStr);
+static constexpr auto reachablePath = jsonPath(reachableStr);
+static constexpr auto lampOnPath    = jsonPath(onStr);
+static constexpr auto sceneIdPath   = jsonPath("0", successStr, idStr);
+
+/* Capabilities of the known lamp types */
+struct lampType_s
+{
+    const char* type;
+    uint8_t caps;
+};
+
+static const lampType_s lampTypes[] = 
+{
+    {"Extended color light",    App::CAP_BRI | App::CAP_HS | App::CAP_CT},
+    {"Color light",             App::CAP_BRI | App::CAP_HS},
+    {"Color temperature light", App::CAP_BRI | App::CAP_CT},
+    {"Dimmable light",          App::CAP_BRI},
+    {"On/Off light",            0},
+    {"On/Off plug-in unit",     0},
+};
+
+/* Slider curves, value of step i of n */
+static constexpr double cube(double x)
+{
+    return x * x * x;
+}
+
+/* CIE L*, equal slider travel changes the perceived brightness equally */
+static constexpr double cieLuminance(double lightness)
+{
+    return (lightness > 8.0) ? cube((lightness + 16.0) / 116.0) : 
+        lightness / 903.3;
+}
+
+static constexpr uint8_t briCurve(uint32_t i, uint32_t n)
+{
+    return (uint8_t)(cieLuminance(100.0 * i / (n - 1)) * 254.0 + 0.5);
+}
+
+/* Hues in degrees spread evenly over the slider: red, orange, yellow, 
+ * green, cyan, blue, magenta and back to red. The warm hues the eye tells 
+ * apart best get more travel. */
+static constexpr uint16_t hueAnchors[] = {0, 30, 60, 120, 180, 240, 300, 360};
+static constexpr uint32_t numHueAnchors = 
+        sizeof(hueAnchors)/sizeof(hueAnchors[0]);
+
+static constexpr double hueDegrees(double x, uint32_t segment)
+{
+    return (segment + 1 >= numHueAnchors) ? 360.0 : hueAnchors[segment] + 
+        (x - segment) * (hueAnchors[segment + 1] - hueAnchors[segment]);
+}
+
+static constexpr uint16_t hueCurve(uint32_t i, uint32_t n)
+{
+    return (uint16_t)(hueDegrees((double)i * (numHueAnchors - 1) / (n - 1), 
+        i * (numHueAnchors - 1) / (n - 1)) * 65535.0 / 360.0 + 0.5);
+}
+
+static constexpr uint8_t satCurve(uint32_t i, uint32_t n)
+{
+    return (uint8_t)((i * 254 + (n - 1) / 2) / (n - 1));
+}
+
+/* Linear in mired from 153 (6500 K) to 500 (2000 K) */
+static constexpr uint16_t ctCurve(uint32_t i, uint32_t n)
+{
+    return (uint16_t)(153 + (i * 347 + (n - 1) / 2) / (n - 1));
+}
+
+/* The slider is quantized to the steps of these tables */
+static constexpr auto briLut = makeLut<uint8_t, 255, briCurve>();
+static constexpr auto hueLut = makeLut<uint16_t, 360, hueCurve>();
+static constexpr auto satLut = makeLut<uint8_t, 255, satCurve>();
+static constexpr auto ctLut = makeLut<uint16_t, 116, ctCurve>();
+
+/* Steps per control mode and the raw ADC steps of hysteresis that keep a 
+ * resting slider quiet. Hue and color temperature are limited to steps 
+ * that can be told apart. */
+struct sliderSteps_s
+{
+    uint16_t steps;
+    uint8_t hysteresis;
+};
+
+static const sliderSteps_s sliderSteps[] = 
+{
+    {briLut.size(), 2},
+    {hueLut.size(), 1},
+    {satLut.size(), 2},
+    {ctLut.size(), 2}   /* steps of 3 mired */
+};
+
+/* Name prefix of the bridge scenes owned by the controller */
+static const char* sceneNamePrefix = "HUE_Controller combo ";
+
 
-static const char* stateStr     = "state";
-static const char* onStr        = "on";
-static const char* colormodeStr = "colormode";
-static const char* briStr       = "bri";
-static const char* hueStr       = "hue";
-static const char* satStr       = "sat";
-static const char* ctStr        = "ct";
+static const uint32_t maxComboIds = 8;
+
+struct lampCombo_s
+{
+    const char* name;
+    bool othersOn;                  /* lamps in neither list are on */
+    uint8_t onIds[maxComboIds];     /* on with the current brightness */
+    uint8_t offIds[maxComboIds];    /* switched off */
+};
+
+/* Lamp combinations selected with the button gestures. The lists hold 
+ * bridge IDs (1 to 255, unused entries are 0) and are resolved to registry 
+ * slots once the lamps are known. Lamps that are part of neither list are 
+ * left untouched unless othersOn is set. */
+static const lampCombo_s lampCombos[] = 
+{
+    {"All lamps on",                true,   {},     {}},
+    {"All but ceiling lamps on",    true,   {},     {1, 2, 3}},
+};
+
+static const int32_t numLampCombos = 
+        sizeof(lampCombos)/sizeof(lampCombos[0]);
 
 
-App::App()
+/* Actions of the button gestures. Combinations are reached directly from 
+ * the current lamp states, without requests for the ones in between. The 
+ * bottom button shuts down however long it is held. */
+const App::gestureBinding_s App::m_GestureBindings[] = 
+{
+    {button_e::TOP,     Gestures::GESTURE_SHORT,    action_e::NEXT_COMBO,   1},
+    {button_e::TOP,     Gestures::GESTURE_DOUBLE,   action_e::NEXT_COMBO,   -1},
+    {button_e::TOP,     Gestures::GESTURE_LONG,     action_e::COMBO,        0},
+    {button_e::TOP,     Gestures::GESTURE_CHORD,    action_e::ALL_OFF,      0},
+    {button_e::MIDDLE,  Gestures::GESTURE_SHORT,    action_e::COMBO,        1},
+    {button_e::MIDDLE,  Gestures::GESTURE_LONG,     action_e::TRACE_DUMP,   0},
+    {button_e::BOTTOM,  Gestures::GESTURE_SHORT,    action_e::SHUTDOWN,     0},
+    {button_e::BOTTOM,  Gestures::GESTURE_LONG,     action_e::SHUTDOWN,     0},
+};
+
+const uint32_t App::m_NumGestureBindings = 
+        sizeof(m_GestureBindings)/sizeof(m_GestureBindings[0]);
+
+
+/* Fields taken from the /lights response, the control capabilities are 
+ * available since API 1.22 */
+const App::lampBinding_s App::m_LampBindings[] = 
+{
+    {{stateStr, onStr},             2,  JsonStream::EVENT_VALUE, 
+        bind_e::BOOL,       offsetof(lampState_s, on),          0,  
+        LAMPFIELD_ON},
+    {{stateStr, reachableStr},      2,  JsonStream::EVENT_VALUE, 
+        bind_e::BOOL,       offsetof(lampState_s, reachable),   0,  
+        LAMPFIELD_REACHABLE},
+    {{stateStr, briStr},            2,  JsonStream::EVENT_VALUE, 
+        bind_e::UINT8,      offsetof(lampState_s, bri),         0,  
+        LAMPFIELD_BRI},
+    {{stateStr, hueStr},            2,  JsonStream::EVENT_VALUE, 
+        bind_e::UINT16,     offsetof(lampState_s, hue),         0,  
+        LAMPFIELD_HUE},
+    {{stateStr, satStr},            2,  JsonStream::EVENT_VALUE, 
+        bind_e::UINT8,      offsetof(lampState_s, sat),         0,  
+        LAMPFIELD_SAT},
+    {{stateStr, ctStr},             2,  JsonStream::EVENT_VALUE, 
+        bind_e::UINT16,     offsetof(lampState_s, ct),          0,  
+        LAMPFIELD_CT},
+    {{stateStr, colormodeStr},      2,  JsonStream::EVENT_VALUE, 
+        bind_e::COLORMODE,  offsetof(lampState_s, mode),        0,  
+        LAMPFIELD_COLORMODE},
+    {{typeStr},                     1,  JsonStream::EVENT_VALUE, 
+        bind_e::TYPE,       offsetof(lampState_s, typeCaps),    0,  
+        LAMPFIELD_TYPE},
+    {{capabilitiesStr, controlStr, colorgamutStr}, 
+                                    3,  JsonStream::EVENT_ARRAY, 
+        bind_e::CAPS,       offsetof(lampState_s, controlCaps), 
+        CAP_BRI | CAP_HS,   LAMPFIELD_GAMUT},
+    {{capabilitiesStr, controlStr, ctStr},
+                                    3,  JsonStream::EVENT_OBJECT, 
+        bind_e::CAPS,       offsetof(lampState_s, controlCaps), 
+        CAP_BRI | CAP_CT,   LAMPFIELD_CT_RANGE},
+};
+
+const uint32_t App::m_NumLampBindings = 
+        sizeof(m_LampBindings)/sizeof(m_LampBindings[0]);
+
+
+static uint8_t capsFromType(const char* type);
+static void feedStream(const char* data, uint32_t len, void* context);
+
+
+App::App() : m_ProbeJson(m_ProbeArena, sizeof(m_ProbeArena))
 {
     m_FirstSend = true;
-    m_NumLamps = 0;
     m_ControlMode = CONTROLMODE_BRIGHTNESS;
-    m_LampComboMode = LAMPCOMBOMODE_ALL_ON;
+    m_LampComboMode = 0;
     m_ColorMode = colorMode_e::CT;
     m_Brightness = 0x00;
     m_HUE = 0x5555;
     m_Saturation = 0xFF;
     m_CT = 300;
+    m_NumGroups = 0;
+    memset(m_Scenes, 0, sizeof(m_Scenes));
+    m_LookHash = 0;
+    m_LookTime = 0;
     m_ShutdownTimer = nullptr;
 }
 
@@ -66,119 +272,67 @@ void App::init(void)
 
     wifi_init();
 
-    /* Get the state of the HUE lamps */
-    int32_t sendLen, recLen;
-    sendLen = RequestGenerator::get(m_WifiSendBuffer,
-        sizeof(m_WifiSendBuffer)/sizeof(m_WifiSendBuffer[0]));
-
-    if(sendLen <= 0) ERROR("Get request generation failed!");
-
-    recLen = wifi_send(m_WifiSendBuffer, sendLen, m_WifiRecBuffer, 
-        sizeof(m_WifiRecBuffer), 10);
-
-    if(recLen <= 0) ERROR("Get request failed!");
-
-    //printf("reclen: %d\n", recLen);
-    //printf(m_WifiRecBuffer);
+    /* Stream the state of the HUE lamps into the registry */
+    m_Lamps.clear();
 
-    char* jsonStart = strchr(m_WifiRecBuffer, '{');
-    if(jsonStart == nullptr) ERROR("JSON string not found!");
+    lightsParse_s lightsParse;
+    lightsParse.slot = -1;
+    JsonStream lightsStream(lightsEvent, &lightsParse);
 
-    JsonObject json(jsonStart);
-    //json.print();
+    if(getStream(lightsStr, lightsStream) == false) 
+        ERROR("Lamp states not received!");
 
-    /* Determine which lamp to get the status from */
-    if(json.getNumObjects(nullptr, 0, &m_NumLamps) == false)
-        ERROR("Number of lamps not found!");
+    if(lightsParse.slot >= 0) addLamp(lightsParse.slot, lightsParse.lamp);
 
-    uint32_t lampToEvaluate = 0;
-    for(uint32_t i = 1; i <= m_NumLamps; i++)
-    {
-        bool lampOn = false;
-        const char* lampOnPath[] = {numStr[i], stateStr, onStr};
-        if(json.getBool(lampOnPath, 
-            sizeof(lampOnPath)/sizeof(lampOnPath[0]), 
-            &lampOn) == false) ERROR("Lamp on state not found!");
+    ESP_LOGI(LOG_TAG, "%d lamps registered", m_Lamps.size());
 
-        if(lampOn)
-        {
-            lampToEvaluate = i;
-            break;
-        }
-    }
+    resolveLampCombos();
+    loadGroups();
 
-    if(lampToEvaluate >= sizeof(numStr)/sizeof(numStr[0]))
-        ERROR("Index of lamp to evaluate to high: %d!", lampToEvaluate);
-    
-    /* Get the color of the selected lamp and set the LED strip 
-     * accordingly if an enabled lamp was found */
-    if(lampToEvaluate > 0)
+    /* Take the color of the first enabled lamp and set the LED strip 
+     * accordingly */
+    lampMask_t lampsToEvaluate = m_Lamps.on() & m_Lamps.reachable();
+    if(lampsToEvaluate != 0)
     {
-        int64_t bri = 0;
-        const char* briPath[] = 
-            {numStr[lampToEvaluate], stateStr, briStr};
-
-        if(json.getInt(briPath, 
-            sizeof(briPath)/sizeof(briPath[0]), 
-            &bri) == false) ERROR("Brightness value not found!");
-
-        m_Brightness = (uint8_t)bri;
-
-        char* colorMode;
-        const char* colorModePath[] = 
-            {numStr[lampToEvaluate], stateStr, colormodeStr};
+        uint8_t slot = __builtin_ctzll(lampsToEvaluate);
 
-        if(json.getString(colorModePath, 
-            sizeof(colorModePath)/sizeof(colorModePath[0]), 
-            &colorMode) == false) ERROR("Color mode not found!");
+        m_Brightness = m_Lamps.bri(slot);
 
-        if(strcmp(colorMode, "hs") == 0)
+        switch(m_Lamps.mode(slot))
         {
-            ESP_LOGI(LOG_TAG, "Color mode HS");
+            case colorMode_e::HS:
+            {
+                ESP_LOGI(LOG_TAG, "Color mode HS");
 
-            int64_t hue = 0;
-            const char* huePath[] = 
-                {numStr[lampToEvaluate], stateStr, hueStr};
+                m_ColorMode = colorMode_e::HS;
+                m_HUE = m_Lamps.hue(slot);
+                m_Saturation = m_Lamps.sat(slot);
+                break;
+            }
 
-            if(json.getInt(huePath, 
-                sizeof(huePath)/sizeof(huePath[0]), 
-                &hue) == false) ERROR("HUE value not found!");
+            case colorMode_e::CT:
+            {
+                ESP_LOGI(LOG_TAG, "Color mode CT");
 
-            int64_t sat = 0;
-            const char* satPath[] = 
-                {numStr[lampToEvaluate], stateStr, satStr};
+                m_ColorMode = colorMode_e::CT;
+                m_CT = m_Lamps.ct(slot);
+                break;
+            }
 
-            if(json.getInt(satPath, 
-                sizeof(satPath)/sizeof(satPath[0]), 
-                &sat) == false) ERROR("Saturation value not found!");
+            default:
+            {
+                ESP_LOGI(LOG_TAG, "Color mode XY or none");
 
-            m_ColorMode = colorMode_e::HS;
-            m_HUE = (uint16_t)hue;
-            m_Saturation = (uint16_t)sat;
+                /* Use default values */
+                break;
+            }
         }
-        else if(strcmp(colorMode, "ct") == 0)
-        {
-            ESP_LOGI(LOG_TAG, "Color mode CT");
-
-            int64_t ct = 0;
-            const char* ctPath[] = 
-                {numStr[lampToEvaluate], stateStr, ctStr};
-
-            if(json.getInt(ctPath, 
-                sizeof(ctPath)/sizeof(ctPath[0]), 
-                &ct) == false) ERROR("CT value not found!");
+    }
 
-            m_ColorMode = colorMode_e::CT;
-            m_CT = (uint16_t)ct;
-        }
-        else if(strcmp(colorMode, "xy") == 0)
-        {
-            ESP_LOGI(LOG_TAG, "Color mode XY");
+    loadScenes();
 
-            /* Use default values */
-        }
-        else ERROR("Color mode unknown: %s!", colorMode);
-    }
+    /* Scene upload and lamp probing are done in the background */
+    xTaskCreate(backgroundTask, "Background task", 4096, nullptr, 4, nullptr);
 
     setMode();
 
@@ -186,9 +340,16 @@ void App::init(void)
 }
 
 
-void App::newAdVal(uint16_t adVal)
+void App::newAdVal(uint16_t step)
 {
-    int32_t contentLen = 0;
+    trace_mark(TRACE_APP);
+
+    /* The transition time is in steps of 100 ms. The default of 200 ms 
+     * bridges the gap to the next slider value. Predicted values get the 
+     * same, no round trip is measured that a shorter one could be derived 
+     * from. */
+    lampCommand_s command = {-1, -1, -1, -1, -1, 2};
+    lampMask_t lamps = m_Lamps.on();
 
     xTimerReset(m_ShutdownTimer, 0);
 
@@ -196,19 +357,24 @@ void App::newAdVal(uint16_t adVal)
     {
         case CONTROLMODE_BRIGHTNESS:
         {
-            int8_t on = -1;
+            /* The dark end of the curve rounds neighbouring steps to the
+             * same brightness, those are not sent again */
+            if((briLut[step] == m_Brightness) && (m_FirstSend == false))
+                return;
+
+            /* The first brightness change switches on the lamps of the 
+             * current combination */
             if(m_FirstSend)
             {
                 m_FirstSend = false;
-                on = 1;
+                command.on = 1;
+                lamps = m_ComboLamps[m_LampComboMode].on;
             }
 
-            m_Brightness = ((uint32_t)adVal*254)/1023;
+            m_Brightness = briLut[step];
             ESP_LOGI(LOG_TAG, "New brightness %d", m_Brightness);
 
-            contentLen = RequestGenerator::put(m_ContentBuffer, 
-                sizeof(m_ContentBuffer)/sizeof(m_ContentBuffer[0]),
-                on, m_Brightness, -1, -1, -1, 2);
+            command.bri = m_Brightness;
 
             break;
         }
@@ -216,12 +382,11 @@ void App::newAdVal(uint16_t adVal)
         case CONTROLMODE_HUE:
         {
             m_ColorMode = colorMode_e::HS;
-            m_HUE = ((uint32_t)adVal*65535)/1023;
+            m_HUE = hueLut[step];
             ESP_LOGI(LOG_TAG, "New HUE %d", m_HUE);
 
-            contentLen = RequestGenerator::put(m_ContentBuffer, 
-                sizeof(m_ContentBuffer)/sizeof(m_ContentBuffer[0]),
-                -1, -1, m_HUE, m_Saturation, -1, 2);
+            command.hue = m_HUE;
+            command.sat = m_Saturation;
 
             break;
         }
@@ -229,12 +394,11 @@ void App::newAdVal(uint16_t adVal)
         case CONTROLMODE_SATURATION:
         {
             m_ColorMode = colorMode_e::HS;
-            m_Saturation = ((uint32_t)adVal*254)/1023;
+            m_Saturation = satLut[step];
             ESP_LOGI(LOG_TAG, "New saturation %d", m_Saturation);
 
-            contentLen = RequestGenerator::put(m_ContentBuffer, 
-                sizeof(m_ContentBuffer)/sizeof(m_ContentBuffer[0]),
-                -1, -1, m_HUE, m_Saturation, -1, 2);
+            command.hue = m_HUE;
+            command.sat = m_Saturation;
             
             break;
         }
@@ -242,12 +406,10 @@ void App::newAdVal(uint16_t adVal)
         case CONTROLMODE_COLOR_TEMPERATURE:
         {
             m_ColorMode = colorMode_e::CT;
-            m_CT = ((uint32_t)adVal*347)/1023 + 153;
+            m_CT = ctLut[step];
             ESP_LOGI(LOG_TAG, "New color temperature %d", m_CT);
 
-            contentLen = RequestGenerator::put(m_ContentBuffer, 
-                sizeof(m_ContentBuffer)/sizeof(m_ContentBuffer[0]),
-                -1, -1, -1, -1, m_CT, 2);
+            command.ct = m_CT;
 
             break;
         }
@@ -259,41 +421,97 @@ void App::newAdVal(uint16_t adVal)
         }
     }
 
-    sendRequest(1, m_NumLamps, contentLen);
+    if(sendCommand(lamps, command) && (command.on == 1))
+    {
+        m_Lamps.setOn(lamps, true);
+    }
+
+    checkScenes();
 }
 
 
-void App::buttonPress(button_e button)
+void App::buttonGesture(button_e button, Gestures::gesture_e gesture)
 {
     xTimerReset(m_ShutdownTimer, 0);
 
-    switch(button)
+    for(uint32_t i = 0; i < m_NumGestureBindings; i++)
+    {
+        const gestureBinding_s& binding = m_GestureBindings[i];
+
+        if((binding.button == button) && (binding.gesture == gesture))
+        {
+            runAction(binding.action, binding.arg);
+            return;
+        }
+    }
+}
+
+
+uint32_t App::gestureButtons(Gestures::gesture_e gesture)
+{
+    uint32_t mask = 0;
+
+    for(uint32_t i = 0; i < m_NumGestureBindings; i++)
+    {
+        if(m_GestureBindings[i].gesture == gesture) 
+            mask |= 1 << (uint32_t)m_GestureBindings[i].button;
+    }
+
+    return mask;
+}
+
+
+void App::runAction(action_e action, int32_t arg)
+{
+    trace_mark(TRACE_APP);
+
+    switch(action)
     {
-        case button_e::TOP:
+        case action_e::NEXT_COMBO:
         {
-            m_LampComboMode++;
-            if(m_LampComboMode >= NUM_LAMPCOMBOMODES)
-                m_LampComboMode = 0;
+            m_LampComboMode = (m_LampComboMode + (arg % numLampCombos) + 
+                numLampCombos) % numLampCombos;
 
             setLampComboMode();
             break;
         }
 
-        case button_e::MIDDLE:
+        case action_e::COMBO:
         {
+            if((arg < 0) || (arg >= numLampCombos)) break;
+
+            m_LampComboMode = arg;
+
+            setLampComboMode();
             break;
         }
 
-        case button_e::BOTTOM:
+        case action_e::ALL_OFF:
         {
-            ESP_LOGI(LOG_TAG, "Bye Bye");
+            lampMask_t lamps = m_Lamps.on();
+            if(lamps == 0) break;
 
-            int32_t contentLen = 0;
-            contentLen = RequestGenerator::put(m_ContentBuffer, 
-                sizeof(m_ContentBuffer)/sizeof(m_ContentBuffer[0]),
-                0, -1, -1, -1, -1, 2);
+            lampCommand_s command = {0, -1, -1, -1, -1, 2};
+            if(sendCommand(lamps, command)) m_Lamps.setOn(lamps, false);
 
-            sendRequest(1, m_NumLamps, contentLen);
+            /* The next brightness change switches them on again */
+            m_FirstSend = true;
+            break;
+        }
+
+        case action_e::TRACE_DUMP:
+        {
+            trace_dump();
+            break;
+        }
+
+        case action_e::SHUTDOWN:
+        {
+            ESP_LOGI(LOG_TAG, "Bye Bye");
+
+            lampCommand_s command = {0, -1, -1, -1, -1, 2};
+            if(sendCommand(m_Lamps.all(), command)) 
+                m_Lamps.setOn(m_Lamps.all(), false);
 
             shutdown(nullptr);
             break;
@@ -302,23 +520,24 @@ void App::buttonPress(button_e button)
 }
 
 
-void App::switchAction(switch_e switchDir)
+void App::switchAction(switch_e switchDir, uint32_t count)
 {
+    int32_t steps = count % NUM_CONTROLMODES;
+
     xTimerReset(m_ShutdownTimer, 0);
 
     switch(switchDir)
     {
         case switch_e::LEFT:
         {
-            m_ControlMode++;
-            if(m_ControlMode >= NUM_CONTROLMODES) m_ControlMode = 0;
+            m_ControlMode = (m_ControlMode + steps) % NUM_CONTROLMODES;
             break;
         }
 
         case switch_e::RIGHT:
         {
-            m_ControlMode--;
-            if(m_ControlMode < 0) m_ControlMode = NUM_CONTROLMODES - 1;
+            m_ControlMode = (m_ControlMode + NUM_CONTROLMODES - steps) % 
+                NUM_CONTROLMODES;
             break;
         }
 
@@ -333,136 +552,1154 @@ void App::switchAction(switch_e switchDir)
 }
 
 
-bool App::sendRequest(uint8_t firstLamp, uint8_t lastLamp, int32_t requestLen)
+bool App::getStream(const char* resource, JsonStream& stream)
 {
-    if(firstLamp > lastLamp) return false;
-    if(requestLen <= 0) return false;
+    int32_t sendLen, recLen;
+    sendLen = RequestGenerator::get(m_WifiSendBuffer,
+        sizeof(m_WifiSendBuffer)/sizeof(m_WifiSendBuffer[0]), resource);
+
+    if(sendLen <= 0) return false;
+
+    recLen = wifi_send_stream(m_WifiSendBuffer, sendLen, m_WifiRecBuffer, 
+        sizeof(m_WifiRecBuffer), 10, feedStream, &stream);
 
-    for(uint8_t lampId = firstLamp; lampId <= lastLamp; lampId++)
+    if(recLen <= 0) return false;
+
+    return stream.finish();
+}
+
+
+void App::resolveLampCombos(void)
+{
+    for(int32_t combo = 0; combo < numLampCombos; combo++)
     {
-        int32_t putLen = RequestGenerator::addPutHeader(m_WifiSendBuffer,
-            sizeof(m_WifiSendBuffer)/sizeof(m_WifiSendBuffer[0]),
-            m_ContentBuffer, requestLen, lampId);
+        const lampCombo_s& lampCombo = lampCombos[combo];
+        comboLamps_s& lamps = m_ComboLamps[combo];
 
-        if(putLen > 0)
-        {
-            wifi_send(m_WifiSendBuffer, putLen, m_WifiRecBuffer, 
-                sizeof(m_WifiRecBuffer)/sizeof(m_WifiRecBuffer[0]), 0);
-        }
-        else
+        lamps.off = m_Lamps.fromIds(lampCombo.offIds, maxComboIds);
+        lamps.on = m_Lamps.fromIds(lampCombo.onIds, maxComboIds);
+
+        if(lampCombo.othersOn) lamps.on |= m_Lamps.all() & ~lamps.off;
+    }
+}
+
+
+void App::loadGroups(void)
+{
+    groupsParse_s parse;
+    parse.valid = false;
+    JsonStream stream(groupsEvent, &parse);
+
+    if(getStream("groups", stream) == false) ERROR("Groups not received!");
+
+    if(parse.valid) addGroup(parse.group);
+
+    ESP_LOGI(LOG_TAG, "%d usable groups", m_NumGroups);
+}
+
+
+void App::addGroup(const group_s& group)
+{
+    /* Single lamp groups are not cheaper than a lamp request */
+    if(__builtin_popcountll(group.lamps) < 2) return;
+
+    if(m_NumGroups >= m_MaxGroups) return;
+
+    /* Keep the groups sorted by size, largest first */
+    uint32_t pos = m_NumGroups++;
+    while((pos > 0) && (__builtin_popcountll(m_Groups[pos - 1].lamps) <
+        __builtin_popcountll(group.lamps)))
+    {
+        m_Groups[pos] = m_Groups[pos - 1];
+        pos--;
+    }
+
+    m_Groups[pos] = group;
+}
+
+
+void App::loadScenes(void)
+{
+    static_assert(numLampCombos <= m_MaxLampCombos, 
+        "Too many lamp combinations!");
+
+    scenesParse_s parse;
+    parse.combo = -1;
+    JsonStream stream(scenesEvent, &parse);
+
+    if(getStream("scenes", stream) == false) ERROR("Scenes not received!");
+
+    addScene(parse);
+}
+
+
+void App::addScene(const scenesParse_s& parse)
+{
+    if(parse.combo < 0) return;
+
+    scene_s& scene = m_Scenes[parse.combo];
+
+    strcpy(scene.id, parse.id);
+
+    /* The application data holds the hash of the lamps the scene has been 
+     * created for. The look of their light states is not known yet, it is 
+     * checked before the scene is recalled. */
+    scene.hash = strtoul(parse.hash, nullptr, 16);
+    scene.look = 0;
+
+    if(scene.hash == sceneHash(parse.combo))
+    {
+        scene.state = sceneState_e::UPDATE;
+    }
+    else
+    {
+        scene.state = sceneState_e::STALE;
+    }
+}
+
+
+void App::lightsEvent(JsonStream& stream, JsonStream::event_e event, 
+        void* context)
+{
+    App& app = App::instance();
+    lightsParse_s& parse = *(lightsParse_s*)context;
+
+    /* Every member of the root object is a lamp, IDs start at 1. A new 
+     * lamp completes the previous one. */
+    if(stream.depth() == 1)
+    {
+        if(event != JsonStream::EVENT_OBJECT) return;
+
+        if(parse.slot >= 0) app.addLamp(parse.slot, parse.lamp);
+
+        uint32_t lampId = strtoul(stream.key(0), nullptr, 10);
+        parse.slot = (lampId > 0) ? app.m_Lamps.add(lampId) : -1;
+
+        if(parse.slot < 0)
         {
-            ESP_LOGE(LOG_TAG, "Put request generation failed!");
-            return false;
+            ESP_LOGW(LOG_TAG, "Lamp %s ignored!", stream.key(0));
+            return;
         }
+
+        /* Unknown lamp types get all commands like before, fields which 
+         * are not reported by a lamp stay zero */
+        lampState_s& lamp = parse.lamp;
+        memset(&lamp, 0, sizeof(lamp));
+        lamp.reachable = true;
+        lamp.mode = colorMode_e::NONE;
+        lamp.typeCaps = CAP_ALL;
+        return;
+    }
+
+    if(parse.slot < 0) return;
+
+    for(uint32_t i = 0; i < m_NumLampBindings; i++)
+    {
+        const lampBinding_s& binding = m_LampBindings[i];
+
+        if((binding.event != event) || 
+            (stream.depth() != binding.depth + 1u)) continue;
+
+        uint32_t level = 0;
+        while((level < binding.depth) && 
+            stream.keyIs(level + 1, binding.keys[level])) level++;
+
+        if(level < binding.depth) continue;
+
+        bindLampField(binding, stream, parse.lamp);
+        break;
     }
-    return true;
 }
 
 
-void App::setMode(void)
+void App::bindLampField(const lampBinding_s& binding, JsonStream& stream, 
+        lampState_s& lamp)
 {
-    switch(m_ControlMode)
+    uint8_t* target = (uint8_t*)&lamp + binding.offset;
+
+    bool valid = false;
+    bool flag;
+    int64_t number;
+
+    switch(binding.bind)
     {
-        case CONTROLMODE_BRIGHTNESS:
+        case bind_e::BOOL:
         {
-            ESP_LOGI(LOG_TAG, "Mode brightness");
-            
-            switch(m_ColorMode)
-            {
-                case colorMode_e::HS:
-                    LedStrip::showBrightness(m_HUE, m_Saturation);
-                    break;
-
-                case colorMode_e::CT:
-                    LedStrip::showBrightness(m_CT);
-                    break;
+            valid = stream.getBool(&flag);
+            if(valid) *(bool*)target = flag;
+            break;
+        }
 
-                default:
-                    break;
-            }
-            
+        case bind_e::UINT8:
+        {
+            valid = stream.getInt(&number) && (number >= 0) && 
+                (number <= UINT8_MAX);
+            if(valid) *target = number;
             break;
         }
 
-        case CONTROLMODE_HUE:
+        case bind_e::UINT16:
         {
-            ESP_LOGI(LOG_TAG, "Mode HUE");
-            LedStrip::showHUE(m_Saturation);
+            valid = stream.getInt(&number) && (number >= 0) && 
+                (number <= UINT16_MAX);
+            if(valid) *(uint16_t*)target = number;
             break;
         }
 
-        case CONTROLMODE_SATURATION:
+        case bind_e::COLORMODE:
         {
-            ESP_LOGI(LOG_TAG, "Mode saturation");
-            LedStrip::showSaturation(m_HUE);
+            const char* colorMode = stream.value();
+            valid = (stream.type() == JsonStream::TYPE_STRING);
+
+            if(valid == false) break;
+
+            if(strcmp(colorMode, "hs") == 0) 
+                *(colorMode_e*)target = colorMode_e::HS;
+            else if(strcmp(colorMode, "ct") == 0) 
+                *(colorMode_e*)target = colorMode_e::CT;
+            else if(strcmp(colorMode, "xy") == 0) 
+                *(colorMode_e*)target = colorMode_e::XY;
+            else valid = false;
 
             break;
         }
 
-        case CONTROLMODE_COLOR_TEMPERATURE:
+        case bind_e::TYPE:
         {
-            ESP_LOGI(LOG_TAG, "Mode white\n");
-            LedStrip::showColorTemperature();
+            valid = (stream.type() == JsonStream::TYPE_STRING) && 
+                (stream.valueTruncated() == false);
+            if(valid) *target = capsFromType(stream.value());
             break;
         }
 
-        default:
+        case bind_e::CAPS:
         {
-            ESP_LOGE(LOG_TAG, "Unknown mode %d!", m_ControlMode);
+            valid = true;
+            *target |= binding.caps;
             break;
         }
     }
+
+    if(valid) lamp.present |= binding.field;
+    else lamp.invalid |= binding.field;
 }
 
 
-void App::setLampComboMode(void)
+void App::addLamp(uint8_t slot, const lampState_s& lamp)
 {
-    int32_t contentLen = 0;
+    uint16_t missing = m_RequiredLampFields & ~lamp.present;
+    if((missing != 0) || (lamp.invalid != 0))
+    {
+        ESP_LOGW(LOG_TAG, "Lamp %d fields missing: 0x%x, invalid: 0x%x", 
+            m_Lamps.id(slot), missing, lamp.invalid);
+    }
+
+    m_Lamps.setOn(LAMP(slot), lamp.on);
+    m_Lamps.setReachable(LAMP(slot), lamp.reachable);
+    m_Lamps.setBri(slot, lamp.bri);
+    m_Lamps.setHue(slot, lamp.hue);
+    m_Lamps.setSat(slot, lamp.sat);
+    m_Lamps.setCt(slot, lamp.ct);
+    m_Lamps.setMode(slot, lamp.mode);
+    /* The control capabilities describe the lamp itself and restrict what 
+     * its type promises, the type is used for lamps without them. A lamp 
+     * of an unknown type without them gets all commands. */
+    m_Lamps.setCaps(slot, (lamp.controlCaps != 0) ? lamp.controlCaps : 
+        lamp.typeCaps);
+}
 
-    switch(m_LampComboMode)
+
+void App::groupsEvent(JsonStream& stream, JsonStream::event_e event, 
+        void* context)
+{
+    App& app = App::instance();
+    groupsParse_s& parse = *(groupsParse_s*)context;
+
+    /* A new group completes the previous one */
+    if(stream.depth() == 1)
     {
-        case LAMPCOMBOMODE_ALL_ON:
-        {
-            ESP_LOGI(LOG_TAG, "All lamps on");
+        if(event != JsonStream::EVENT_OBJECT) return;
 
-            contentLen = RequestGenerator::put(m_ContentBuffer, 
-                sizeof(m_ContentBuffer)/sizeof(m_ContentBuffer[0]),
-                1, m_Brightness, -1, -1, -1, 2);
+        if(parse.valid) app.addGroup(parse.group);
 
-            sendRequest(1, m_NumLamps, contentLen);
-            break;
-        }
+        uint32_t groupId = strtoul(stream.key(0), nullptr, 10);
+        parse.valid = (groupId > 0) && (groupId <= UINT8_MAX);
+        parse.group.id = groupId;
+        parse.group.lamps = 0;
+        return;
+    }
 
-        case LAMPCOMBOMODE_NO_CEILING:
-        {
-            ESP_LOGI(LOG_TAG, "All but ceiling lamps on");
+    if(parse.valid == false) return;
+
+    if((event == JsonStream::EVENT_VALUE) && (stream.depth() == 3) && 
+        stream.keyIs(1, lightsStr))
+    {
+        /* Groups with unknown lamps would reach too far */
+        int32_t slot = app.m_Lamps.slot(strtoul(stream.value(), nullptr, 10));
+        if(slot < 0) parse.valid = false;
+        else parse.group.lamps |= LAMP(slot);
+    }
+}
 
-            contentLen = RequestGenerator::put(m_ContentBuffer, 
-                sizeof(m_ContentBuffer)/sizeof(m_ContentBuffer[0]),
-                0, -1, -1, -1, -1, 2);
 
-            sendRequest(1, 3, contentLen);
+void App::scenesEvent(JsonStream& stream, JsonStream::event_e event, 
+        void* context)
+{
+    App& app = App::instance();
+    scenesParse_s& parse = *(scenesParse_s*)context;
 
-            contentLen = RequestGenerator::put(m_ContentBuffer, 
-                sizeof(m_ContentBuffer)/sizeof(m_ContentBuffer[0]),
-                1, m_Brightness, -1, -1, -1, 2);
+    /* A new scene completes the previous one */
+    if(stream.depth() == 1)
+    {
+        if(event != JsonStream::EVENT_OBJECT) return;
 
-            sendRequest(4, m_NumLamps, contentLen);
-            break;
-        }
+        app.addScene(parse);
 
-        default:
-        {
-            ESP_LOGE(LOG_TAG, "Unknown lamp combo mode!");
-            break;
-        }
+        parse.combo = -1;
+        parse.hash[0] = '\0';
+
+        if(strlen(stream.key(0)) < sizeof(parse.id)) 
+            strcpy(parse.id, stream.key(0));
+        else parse.id[0] = '\0';
+
+        return;
+    }
+
+    if((event != JsonStream::EVENT_VALUE) || (parse.id[0] == '\0')) return;
+
+    if((stream.depth() == 2) && stream.keyIs(1, nameStr))
+    {
+        const char* sceneName = stream.value();
+
+        if(strncmp(sceneName, sceneNamePrefix, 
+            strlen(sceneNamePrefix)) != 0) return;
+
+        char* comboEnd;
+        int32_t combo = strtol(sceneName + strlen(sceneNamePrefix), 
+            &comboEnd, 10);
+
+        if((*comboEnd != '\0') || (combo < 0) || 
+            (combo >= numLampCombos)) return;
+
+        parse.combo = combo;
+    }
+    else if((stream.depth() == 3) && stream.keyIs(1, appdataStr) && 
+        stream.keyIs(2, dataStr))
+    {
+        if(strlen(stream.value()) < sizeof(parse.hash)) 
+            strcpy(parse.hash, stream.value());
     }
 }
 
 
-void App::shutdown(TimerHandle_t timer)
+void App::lightstatesEvent(JsonStream& stream, JsonStream::event_e event, 
+        void* context)
 {
-    ESP_ERROR_CHECK(gpio_set_level(GPIO_SHUTDOWN, 1));
+    lightstatesParse_s& parse = *(lightstatesParse_s*)context;
+
+    /* The states come as {"lightstates": {"<lamp>": {"on": true, ...}}} */
+    if((event != JsonStream::EVENT_VALUE) || (stream.depth() != 3) || 
+        (stream.keyIs(0, lightstatesStr) == false)) return;
+
+    uint32_t lampId = strtoul(stream.key(1), nullptr, 10);
+
+    uint32_t i = 0;
+    while((i < parse.numLamps) && (parse.lamps[i].id != lampId)) i++;
+
+    if(i >= parse.numLamps) return;
+
+    const RequestGenerator::sceneLamp_s& lamp = parse.lamps[i];
+
+    /* Fields the scene does not set for the lamp are not compared */
+    if(stream.keyIs(2, onStr))
+    {
+        bool on;
+        parse.present[i] |= LAMPFIELD_ON;
+        if((stream.getBool(&on) == false) || (on != lamp.on)) 
+            parse.differing |= LAMP(i);
+        return;
+    }
+
+    uint16_t field;
+    int64_t target;
+
+    if(stream.keyIs(2, briStr))
+    {
+        field = LAMPFIELD_BRI;
+        target = lamp.bri;
+    }
+    else if(stream.keyIs(2, hueStr))
+    {
+        field = LAMPFIELD_HUE;
+        target = lamp.hue;
+    }
+    else if(stream.keyIs(2, satStr))
+    {
+        field = LAMPFIELD_SAT;
+        target = lamp.sat;
+    }
+    else if(stream.keyIs(2, ctStr))
+    {
+        field = LAMPFIELD_CT;
+        target = lamp.ct;
+    }
+    else return;
+
+    if(target < 0) return;
+
+    int64_t number;
+    parse.present[i] |= field;
+    if((stream.getInt(&number) == false) || (number != target)) 
+        parse.differing |= LAMP(i);
+}
+
+
+void App::replyEvent(JsonStream& stream, JsonStream::event_e event, 
+        void* context)
+{
+    reply_s& reply = *(reply_s*)context;
+
+    /* Replies come as [{"success": ...}, {"error": {"type": <type>, ...}}] */
+    if((stream.depth() == 2) && stream.keyIs(1, successStr))
+    {
+        reply.success = true;
+        return;
+    }
+
+    int64_t errorType;
+    if((event == JsonStream::EVENT_VALUE) && (stream.depth() == 3) && 
+        stream.keyIs(1, errorStr) && stream.keyIs(2, typeStr) &&
+        stream.getInt(&errorType) && (reply.error == 0))
+    {
+        reply.error = errorType;
+    }
+}
+
+
+void App::probeLamp(uint8_t slot)
+{
+    char resource[16];
+    snprintf(resource, sizeof(resource), "%s/%d", lightsStr, m_Lamps.id(slot));
+
+    int32_t sendLen, recLen;
+    sendLen = RequestGenerator::get(m_BackgroundSendBuffer,
+        sizeof(m_BackgroundSendBuffer)/sizeof(m_BackgroundSendBuffer[0]), 
+        resource);
+
+    if(sendLen <= 0) return;
+
+    recLen = wifi_send(m_BackgroundSendBuffer, sendLen, m_BackgroundRecBuffer, 
+        sizeof(m_BackgroundRecBuffer) - 1, 0);
+
+    if(recLen <= 0) return;
+
+    m_BackgroundRecBuffer[recLen] = '\0';
+
+    char* jsonStart = strchr(m_BackgroundRecBuffer, '{');
+    if(jsonStart == nullptr) return;
+
+    /* Only the state is of interest, the rest of the lamp is skipped */
+    JsonObject& json = m_ProbeJson;
+    if(json.reparse(jsonStart, 
+        recLen - (jsonStart - m_BackgroundRecBuffer), true) == false) return;
+
+    /* Descend to the state once and read the fields relative to it */
+    JsonObject::cursor_t state;
+    if(json.getCursor(statePath, &state) == false) return;
+
+    bool reachable = false;
+    bool lampOn = false;
+
+    if(json.get(reachablePath, &reachable, state) == false) return;
+    if(json.get(lampOnPath, &lampOn, state) == false) return;
+
+    const JsonObject::arenaStats_s& stats = json.arenaStats();
+    ESP_LOGD(LOG_TAG, "Probe arena %d of %d bytes, high water %d, "
+        "%d overflows in %d parses", stats.used, stats.capacity, 
+        stats.highWater, stats.overflows, stats.parses);
+
+    ESP_LOGI(LOG_TAG, "Lamp %d reachable: %d, on: %d", 
+        m_Lamps.id(slot), reachable, lampOn);
+
+    /* The input task has a higher priority and may preempt */
+    portENTER_CRITICAL();
+    m_Lamps.setReachable(LAMP(slot), reachable);
+    m_Lamps.setOn(LAMP(slot), lampOn);
+    portEXIT_CRITICAL();
+}
+
+
+bool App::uploadScene(int32_t combo)
+{
+    scene_s& scene = m_Scenes[combo];
+
+    switch(scene.state)
+    {
+        /* A scene is only created once the one it replaces is gone, 
+         * otherwise it would be left behind on the bridge */
+        case sceneState_e::STALE:
+        {
+            if(deleteScene(combo) == false) return false;
+
+            scene.state = sceneState_e::MISSING;
+            return createScene(combo);
+        }
+
+        case sceneState_e::MISSING:
+        {
+            return createScene(combo);
+        }
+
+        case sceneState_e::UPDATE:
+        {
+            return updateScene(combo);
+        }
+
+        default:
+        {
+            return true;
+        }
+    }
+}
+
+
+bool App::createScene(int32_t combo)
+{
+    scene_s& scene = m_Scenes[combo];
+
+    int32_t contentLen, sendLen, recLen;
+
+    const look_s sceneLook = look();
+
+    RequestGenerator::sceneLamp_s lamps[LampRegistry::MAX_LAMPS];
+    uint32_t numLamps = sceneLamps(combo, sceneLook, lamps);
+
+    if(numLamps == 0) return false;
+
+    char sceneName[32];
+    snprintf(sceneName, sizeof(sceneName), "%s%d", sceneNamePrefix, combo);
+
+    uint32_t hash = sceneHash(combo);
+
+    char hashStr[9];
+    snprintf(hashStr, sizeof(hashStr), "%08x", hash);
+
+    contentLen = RequestGenerator::createScene(m_BackgroundContentBuffer,
+        sizeof(m_BackgroundContentBuffer)/sizeof(m_BackgroundContentBuffer[0]),
+        sceneName, hashStr, lamps, numLamps);
+
+    if(contentLen <= 0) return false;
+
+    sendLen = RequestGenerator::addSceneHeader(m_BackgroundSendBuffer,
+        sizeof(m_BackgroundSendBuffer)/sizeof(m_BackgroundSendBuffer[0]),
+        "POST", m_BackgroundContentBuffer, contentLen, nullptr);
+
+    if(sendLen <= 0) return false;
+
+    recLen = wifi_send(m_BackgroundSendBuffer, sendLen, m_BackgroundRecBuffer, 
+        sizeof(m_BackgroundRecBuffer) - 1, 0);
+
+    if(recLen <= 0) return false;
+
+    m_BackgroundRecBuffer[recLen] = '\0';
+
+    /* The response is [{"success": {"id": "<scene id>"}}] */
+    char* jsonStart = strchr(m_BackgroundRecBuffer, '[');
+    if(jsonStart == nullptr) return false;
+
+    JsonObject json(jsonStart, recLen - (jsonStart - m_BackgroundRecBuffer));
+
+    char* sceneId;
+    if(json.get(sceneIdPath, &sceneId) == false) return false;
+
+    if(strlen(sceneId) >= sizeof(scene.id)) return false;
+
+    strcpy(scene.id, sceneId);
+    scene.hash = hash;
+    scene.look = lookHash(sceneLook);
+    scene.state = sceneState_e::READY;
+
+    /* The look may have changed during the upload */
+    checkScenes();
+
+    return true;
+}
+
+
+bool App::deleteScene(int32_t combo)
+{
+    scene_s& scene = m_Scenes[combo];
+
+    m_BackgroundContentBuffer[0] = '\0';
+    int32_t sendLen = RequestGenerator::addSceneHeader(m_BackgroundSendBuffer,
+        sizeof(m_BackgroundSendBuffer)/sizeof(m_BackgroundSendBuffer[0]),
+        "DELETE", m_BackgroundContentBuffer, 0, scene.id);
+
+    if(sendLen <= 0) return false;
+
+    reply_s reply = {false, 0};
+    JsonStream stream(replyEvent, &reply);
+
+    int32_t recLen = wifi_send_stream(m_BackgroundSendBuffer, sendLen, 
+        m_BackgroundRecBuffer, sizeof(m_BackgroundRecBuffer), 0, feedStream, 
+        &stream);
+
+    if(recLen <= 0) return false;
+
+    /* A scene that is gone already counts as deleted */
+    if((reply.error == 0) && reply.success) return true;
+    if(reply.error == m_ErrorNotAvailable) return true;
+
+    ESP_LOGW(LOG_TAG, "Scene %s not deleted, error %d", scene.id, 
+        (int32_t)reply.error);
+
+    return false;
+}
+
+
+bool App::updateScene(int32_t combo)
+{
+    scene_s& scene = m_Scenes[combo];
+
+    int32_t contentLen, sendLen, recLen;
+
+    const look_s sceneLook = look();
+
+    RequestGenerator::sceneLamp_s lamps[LampRegistry::MAX_LAMPS];
+
+    lightstatesParse_s parse;
+    parse.lamps = lamps;
+    parse.numLamps = sceneLamps(combo, sceneLook, lamps);
+    parse.differing = 0;
+    memset(parse.present, 0, sizeof(parse.present));
+
+    /* Read the light states of the scene, only those which differ are 
+     * written. Every write goes to the flash of the bridge. */
+    char resource[40];
+    snprintf(resource, sizeof(resource), "scenes/%s", scene.id);
+
+    sendLen = RequestGenerator::get(m_BackgroundSendBuffer,
+        sizeof(m_BackgroundSendBuffer)/sizeof(m_BackgroundSendBuffer[0]), 
+        resource);
+
+    if(sendLen <= 0) return false;
+
+    JsonStream stream(lightstatesEvent, &parse);
+
+    recLen = wifi_send_stream(m_BackgroundSendBuffer, sendLen, 
+        m_BackgroundRecBuffer, sizeof(m_BackgroundRecBuffer), 0, feedStream, 
+        &stream);
+
+    if((recLen <= 0) || (stream.finish() == false)) return false;
+
+    for(uint32_t i = 0; i < parse.numLamps; i++)
+    {
+        const RequestGenerator::sceneLamp_s& lamp = lamps[i];
+
+        uint16_t fields = LAMPFIELD_ON | 
+            ((lamp.bri >= 0) ? LAMPFIELD_BRI : 0) | 
+            ((lamp.hue >= 0) ? LAMPFIELD_HUE : 0) | 
+            ((lamp.sat >= 0) ? LAMPFIELD_SAT : 0) | 
+            ((lamp.ct >= 0) ? LAMPFIELD_CT : 0);
+
+        if(((parse.differing & LAMP(i)) == 0) && 
+            (parse.present[i] == fields)) continue;
+
+        contentLen = RequestGenerator::put(m_BackgroundContentBuffer, 
+            sizeof(m_BackgroundContentBuffer)/
+            sizeof(m_BackgroundContentBuffer[0]),
+            lamp.on, lamp.bri, lamp.hue, lamp.sat, lamp.ct, -1);
+
+        if(contentLen <= 0) return false;
+
+        sendLen = RequestGenerator::addLightstateHeader(m_BackgroundSendBuffer,
+            sizeof(m_BackgroundSendBuffer)/sizeof(m_BackgroundSendBuffer[0]),
+            m_BackgroundContentBuffer, contentLen, scene.id, lamp.id);
+
+        if(sendLen <= 0) return false;
+
+        reply_s reply = {false, 0};
+        JsonStream replyStream(replyEvent, &reply);
+
+        recLen = wifi_send_stream(m_BackgroundSendBuffer, sendLen, 
+            m_BackgroundRecBuffer, sizeof(m_BackgroundRecBuffer), 0, 
+            feedStream, &replyStream);
+
+        if((recLen <= 0) || (reply.success == false) || (reply.error != 0)) 
+            return false;
+    }
+
+    scene.look = lookHash(sceneLook);
+    scene.state = sceneState_e::READY;
+
+    /* The look may have changed during the update */
+    checkScenes();
+
+    return true;
+}
+
+
+uint32_t App::sceneLamps(int32_t combo, const look_s& look, 
+        RequestGenerator::sceneLamp_s* lamps) const
+{
+    lampMask_t onLamps = m_ComboLamps[combo].on;
+    lampMask_t remaining = onLamps | m_ComboLamps[combo].off;
+    uint32_t numLamps = 0;
+
+    /* The lamps switched on get the values a per lamp switch would send */
+    while(remaining != 0)
+    {
+        uint8_t slot = __builtin_ctzll(remaining);
+        remaining &= ~LAMP(slot);
+
+        uint8_t caps = m_Lamps.caps(slot);
+        bool on = (onLamps & LAMP(slot)) != 0;
+        bool hs = on && (look.mode == colorMode_e::HS) && (caps & CAP_HS);
+        bool ct = on && (look.mode == colorMode_e::CT) && (caps & CAP_CT);
+
+        RequestGenerator::sceneLamp_s& lamp = lamps[numLamps++];
+        lamp.id = m_Lamps.id(slot);
+        lamp.on = on;
+        lamp.bri = (on && (caps & CAP_BRI)) ? look.bri : -1;
+        lamp.hue = hs ? look.hue : -1;
+        lamp.sat = hs ? look.sat : -1;
+        lamp.ct = ct ? look.ct : -1;
+    }
+
+    return numLamps;
+}
+
+
+App::look_s App::look(void) const
+{
+    look_s look;
+
+    portENTER_CRITICAL();
+    look.bri = m_Brightness;
+    look.mode = m_ColorMode;
+    look.hue = m_HUE;
+    look.sat = m_Saturation;
+    look.ct = m_CT;
+    portEXIT_CRITICAL();
+
+    return look;
+}
+
+
+uint32_t App::lookHash(const look_s& look)
+{
+    /* FNV-1a, 0 is left for an unknown look */
+    uint32_t hash = 2166136261U;
+
+    uint8_t data[] = {look.bri, (uint8_t)look.mode, 
+        (uint8_t)look.hue, (uint8_t)(look.hue >> 8), look.sat, 
+        (uint8_t)look.ct, (uint8_t)(look.ct >> 8)};
+    for(uint32_t i = 0; i < sizeof(data); i++)
+    {
+        hash ^= data[i];
+        hash *= 16777619U;
+    }
+
+    return (hash != 0) ? hash : 1;
+}
+
+
+uint32_t App::sceneHash(int32_t combo) const
+{
+    lampMask_t onLamps = m_ComboLamps[combo].on;
+    lampMask_t lamps = onLamps | m_ComboLamps[combo].off;
+
+    /* FNV-1a over the bridge IDs and target states, independent of the 
+     * registry slots */
+    uint32_t hash = 2166136261U;
+
+    while(lamps != 0)
+    {
+        uint8_t slot = __builtin_ctzll(lamps);
+        lamps &= ~LAMP(slot);
+
+        uint8_t data[] = {m_Lamps.id(slot), (uint8_t)((onLamps >> slot) & 1)};
+        for(uint32_t i = 0; i < sizeof(data); i++)
+        {
+            hash ^= data[i];
+            hash *= 16777619U;
+        }
+    }
+
+    return hash;
+}
+
+
+void App::checkScenes(void)
+{
+    uint32_t current = lookHash(look());
+
+    if(current != m_LookHash)
+    {
+        m_LookHash = current;
+        m_LookTime = millis();
+    }
+
+    /* Scenes of another look are updated by the background task, a look 
+     * that returns to that of a scene makes it usable again */
+    for(int32_t combo = 0; combo < numLampCombos; combo++)
+    {
+        scene_s& scene = m_Scenes[combo];
+
+        if((scene.state == sceneState_e::READY) && (scene.look != current))
+            scene.state = sceneState_e::UPDATE;
+        else if((scene.state == sceneState_e::UPDATE) && 
+            (scene.look == current))
+            scene.state = sceneState_e::READY;
+    }
+}
+
+
+bool App::lookSettled(void) const
+{
+    return (millis() - m_LookTime) >= m_SceneQuietTime;
+}
+
+
+bool App::sendCommand(lampMask_t lamps, const lampCommand_s& command)
+{
+    enum field_e : uint8_t
+    {
+        FIELD_ON = 0x01,
+        FIELD_BRI = 0x02,
+        FIELD_HS = 0x04,
+        FIELD_CT = 0x08,
+        NUM_FIELD_SETS = 0x10
+    };
+
+    uint8_t commandFields = 0;
+    if(command.on >= 0) commandFields |= FIELD_ON;
+    if(command.bri >= 0) commandFields |= FIELD_BRI;
+    if((command.hue >= 0) || (command.sat >= 0)) commandFields |= FIELD_HS;
+    if(command.ct >= 0) commandFields |= FIELD_CT;
+
+    /* Sort the lamps by the fields they are able to render */
+    lampMask_t lampsByFields[NUM_FIELD_SETS] = {0};
+
+    lamps &= m_Lamps.all();
+    while(lamps != 0)
+    {
+        uint8_t slot = __builtin_ctzll(lamps);
+        lamps &= ~LAMP(slot);
+
+        uint8_t caps = m_Lamps.caps(slot);
+        uint8_t fields = commandFields & (FIELD_ON | 
+            ((caps & CAP_BRI) ? FIELD_BRI : 0) |
+            ((caps & CAP_HS) ? FIELD_HS : 0) |
+            ((caps & CAP_CT) ? FIELD_CT : 0));
+
+        lampsByFields[fields] |= LAMP(slot);
+    }
+
+    /* Lamps without any supported field are skipped */
+    bool success = true;
+    for(uint8_t fields = 1; fields < NUM_FIELD_SETS; fields++)
+    {
+        if(lampsByFields[fields] == 0) continue;
+
+        int32_t contentLen = RequestGenerator::put(m_ContentBuffer, 
+            sizeof(m_ContentBuffer)/sizeof(m_ContentBuffer[0]),
+            (fields & FIELD_ON) ? command.on : -1,
+            (fields & FIELD_BRI) ? command.bri : -1,
+            (fields & FIELD_HS) ? command.hue : -1,
+            (fields & FIELD_HS) ? command.sat : -1,
+            (fields & FIELD_CT) ? command.ct : -1,
+            command.transitiontime);
+
+        if(sendRequest(lampsByFields[fields], contentLen) == false) 
+            success = false;
+    }
+
+    return success;
+}
+
+
+bool App::sendRequest(lampMask_t lamps, int32_t requestLen)
+{
+    lamps &= m_Lamps.all() & m_Lamps.reachable();
+
+    if(lamps == 0) return false;
+    if(requestLen <= 0) return false;
+
+    /* Unreachable lamps may receive the request as part of a group */
+    lampMask_t allowed = lamps | (m_Lamps.all() & ~m_Lamps.reachable());
+
+    /* A single group request reaches all lamps at once */
+    if(allowed == m_Lamps.all()) return sendGroupRequest(0, requestLen);
+
+    /* Cover as many lamps as possible with groups lying completely
+     * inside the allowed lamps */
+    for(uint32_t i = 0; i < m_NumGroups; i++)
+    {
+        lampMask_t groupLamps = m_Groups[i].lamps;
+
+        if((groupLamps & allowed) != groupLamps) continue;
+        if((groupLamps & lamps) == 0) continue;
+
+        if(sendGroupRequest(m_Groups[i].id, requestLen) == false) 
+            return false;
+
+        lamps &= ~groupLamps;
+    }
+
+    /* Address the rest lamp by lamp */
+    while(lamps != 0)
+    {
+        uint8_t slot = __builtin_ctzll(lamps);
+        lamps &= ~LAMP(slot);
+
+        if(sendLampRequest(slot, requestLen) == false) return false;
+    }
+
+    return true;
+}
+
+
+bool App::sendLampRequest(uint8_t slot, int32_t requestLen)
+{
+    int32_t putLen = RequestGenerator::addPutHeader(m_WifiSendBuffer,
+        sizeof(m_WifiSendBuffer)/sizeof(m_WifiSendBuffer[0]),
+        m_ContentBuffer, requestLen, m_Lamps.id(slot));
+
+    if(putLen <= 0)
+    {
+        ESP_LOGE(LOG_TAG, "Put request generation failed!");
+        return false;
+    }
+
+    trace_mark(TRACE_REQUEST);
+
+    /* Parameters of a lamp which is off can not be modified, it is left 
+     * out of the commands for lamps that are on */
+    reply_s reply = {false, 0};
+    JsonStream stream(replyEvent, &reply);
+
+    wifi_send_stream(m_WifiSendBuffer, putLen, m_WifiRecBuffer, 
+        sizeof(m_WifiRecBuffer), 0, feedStream, &stream);
+
+    if(reply.error == m_ErrorNotModifiable)
+    {
+        ESP_LOGW(LOG_TAG, "Lamp %d is off", m_Lamps.id(slot));
+        m_Lamps.setOn(LAMP(slot), false);
+    }
+
+    return true;
+}
+
+
+bool App::sendGroupRequest(uint8_t groupId, int32_t requestLen)
+{
+    int32_t putLen = RequestGenerator::addGroupPutHeader(m_WifiSendBuffer,
+        sizeof(m_WifiSendBuffer)/sizeof(m_WifiSendBuffer[0]),
+        m_ContentBuffer, requestLen, groupId);
+
+    if(putLen <= 0)
+    {
+        ESP_LOGE(LOG_TAG, "Group put request generation failed!");
+        return false;
+    }
+
+    trace_mark(TRACE_REQUEST);
+
+    wifi_send(m_WifiSendBuffer, putLen, m_WifiRecBuffer, 
+        sizeof(m_WifiRecBuffer)/sizeof(m_WifiRecBuffer[0]), 0);
+
+    return true;
+}
+
+
+void App::setMode(void)
+{
+    if(m_ControlMode < NUM_CONTROLMODES)
+    {
+        const sliderSteps_s& steps = sliderSteps[m_ControlMode];
+        Input::setSteps(steps.steps, steps.hysteresis);
+    }
+
+    switch(m_ControlMode)
+    {
+        case CONTROLMODE_BRIGHTNESS:
+        {
+            ESP_LOGI(LOG_TAG, "Mode brightness");
+            
+            switch(m_ColorMode)
+            {
+                case colorMode_e::HS:
+                    LedStrip::showBrightness(m_HUE, m_Saturation);
+                    break;
+
+                case colorMode_e::CT:
+                    LedStrip::showBrightness(m_CT);
+                    break;
+
+                default:
+                    break;
+            }
+            
+            break;
+        }
+
+        case CONTROLMODE_HUE:
+        {
+            ESP_LOGI(LOG_TAG, "Mode HUE");
+            LedStrip::showHUE(m_Saturation);
+            break;
+        }
+
+        case CONTROLMODE_SATURATION:
+        {
+            ESP_LOGI(LOG_TAG, "Mode saturation");
+            LedStrip::showSaturation(m_HUE);
+
+            break;
+        }
+
+        case CONTROLMODE_COLOR_TEMPERATURE:
+        {
+            ESP_LOGI(LOG_TAG, "Mode white\n");
+            LedStrip::showColorTemperature();
+            break;
+        }
+
+        default:
+        {
+            ESP_LOGE(LOG_TAG, "Unknown mode %d!", m_ControlMode);
+            break;
+        }
+    }
+}
+
+
+void App::setLampComboMode(void)
+{
+    int32_t contentLen = 0;
+
+    const lampCombo_s& combo = lampCombos[m_LampComboMode];
+    ESP_LOGI(LOG_TAG, "%s", combo.name);
+
+    /* Only address lamps that are not in their target state yet */
+    const comboLamps_s& lamps = m_ComboLamps[m_LampComboMode];
+    lampMask_t switchOff = lamps.off & m_Lamps.on();
+    lampMask_t switchOn = lamps.on & ~m_Lamps.on();
+
+    if((switchOff == 0) && (switchOn == 0)) return;
+
+    /* Recall the bridge scene of the combination with a single request */
+    scene_s& scene = m_Scenes[m_LampComboMode];
+    if(scene.state == sceneState_e::READY)
+    {
+        contentLen = RequestGenerator::recallScene(m_ContentBuffer, 
+            sizeof(m_ContentBuffer)/sizeof(m_ContentBuffer[0]), scene.id);
+
+        if(sendGroupRequest(0, contentLen))
+        {
+            m_Lamps.setOn(switchOff, false);
+            m_Lamps.setOn(switchOn, true);
+            return;
+        }
+    }
+
+    if(switchOff != 0)
+    {
+        lampCommand_s command = {0, -1, -1, -1, -1, 2};
+        if(sendCommand(switchOff, command)) m_Lamps.setOn(switchOff, false);
+    }
+
+    /* The same values as the scene, see sceneLamps() */
+    if(switchOn != 0)
+    {
+        lampCommand_s command = {1, m_Brightness, -1, -1, -1, 2};
+
+        if(m_ColorMode == colorMode_e::HS)
+        {
+            command.hue = m_HUE;
+            command.sat = m_Saturation;
+        }
+        else if(m_ColorMode == colorMode_e::CT)
+        {
+            command.ct = m_CT;
+        }
+
+        if(sendCommand(switchOn, command)) m_Lamps.setOn(switchOn, true);
+    }
+}
+
+
+void App::backgroundTask(void* pParam)
+{
+    App& app = App::instance();
+
+    app.syncScenes();
+    JsonObject::logProfile("scenes");
+
+    /* Probe one unreachable lamp at a time, round robin */
+    uint8_t lastProbed = 0;
+    while(true)
+    {
+        vTaskDelay(pdMS_TO_TICKS(m_ProbeInterval));
+
+        /* Scenes are not rewritten while the slider is being moved */
+        if(app.lookSettled()) app.syncScenes();
+        Input::logStats();
+
+        lampMask_t unreachable = app.m_Lamps.all() & ~app.m_Lamps.reachable();
+        if(unreachable == 0) continue;
+
+        lampMask_t next = unreachable & ~LAMP_RANGE(0, lastProbed);
+        if(next == 0) next = unreachable;
+
+        lastProbed = __builtin_ctzll(next);
+        app.probeLamp(lastProbed);
+        JsonObject::logProfile("probe");
+    }
+}
+
+
+void App::syncScenes(void)
+{
+    /* Create missing, replace stale and update outdated scenes */
+    for(int32_t combo = 0; combo < numLampCombos; combo++)
+    {
+        if(m_Scenes[combo].state == sceneState_e::READY) continue;
+
+        if(uploadScene(combo))
+        {
+            ESP_LOGI(LOG_TAG, "Scene of combination %d uploaded", combo);
+        }
+        else
+        {
+            ESP_LOGE(LOG_TAG, "Scene upload of combination %d failed!", combo);
+        }
+    }
+}
+
+
+void App::shutdown(TimerHandle_t timer)
+{
+    ESP_ERROR_CHECK(gpio_set_level(GPIO_SHUTDOWN, 1));
+}
+
+
+static uint8_t capsFromType(const char* type)
+{
+    for(uint32_t i = 0; i < sizeof(lampTypes)/sizeof(lampTypes[0]); i++)
+    {
+        if(strcmp(type, lampTypes[i].type) == 0) return lampTypes[i].caps;
+    }
+
+    /* Unknown lamp types get all commands like before */
+    return App::CAP_ALL;
+}
+
+
+static void feedStream(const char* data, uint32_t len, void* context)
+{
+    ((JsonStream*)context)->feed(data, len);
 }
 
 
@@ -6,6 +6,10 @@
 #include "Wifi.h"
 #include "LedStrip.h"
 #include "Input.h"
+#include "LampRegistry.h"
+#include "JsonStream.h"
+#include "JsonObject.h"
+#include "RequestGenerator.h"
 
 #include "FreeRTOS.h"
 #include "timers.h"
@@ -29,6 +33,14 @@ class App
 {
 public:
 
+    enum capability_e : uint8_t
+    {
+        CAP_BRI = 0x01,
+        CAP_HS = 0x02,
+        CAP_CT = 0x04,
+        CAP_ALL = CAP_BRI | CAP_HS | CAP_CT
+    };
+
     static App& instance(void)
     {
         static App instance;
@@ -37,9 +49,14 @@ public:
 
     void init(void);
 
-    void newAdVal(uint16_t adVal);
-    void buttonPress(button_e button);
-    void switchAction(switch_e switchDir);
+    /* step is the slider position in the steps of the control mode */
+    void newAdVal(uint16_t step);
+    void buttonGesture(button_e button, Gestures::gesture_e gesture);
+    /* Repeated switches are handled as one with their net effect */
+    void switchAction(switch_e switchDir, uint32_t count = 1);
+
+    /* Mask of the buttons with an action bound to the gesture */
+    static uint32_t gestureButtons(Gestures::gesture_e gesture);
 
 private:
 
@@ -52,31 +69,213 @@ private:
         NUM_CONTROLMODES
     };
 
-    enum lampComboMode : int32_t
+    /* Negative values are not sent */
+    struct lampCommand_s
+    {
+        int8_t on;
+        int16_t bri;
+        int32_t hue;
+        int16_t sat;
+        int32_t ct;
+        int32_t transitiontime;
+    };
+
+    enum class action_e : uint8_t
+    {
+        NEXT_COMBO = 0,     /* arg combinations further */
+        COMBO,              /* straight to combination arg */
+        ALL_OFF,
+        TRACE_DUMP,
+        SHUTDOWN
+    };
+
+    struct gestureBinding_s
+    {
+        button_e button;
+        Gestures::gesture_e gesture;
+        action_e action;
+        int32_t arg;
+    };
+
+    struct group_s
+    {
+        uint8_t id;
+        lampMask_t lamps;
+    };
+
+    enum class sceneState_e : uint8_t
     {
-        LAMPCOMBOMODE_ALL_ON = 0,
-        LAMPCOMBOMODE_NO_CEILING,
-        NUM_LAMPCOMBOMODES
+        MISSING = 0,
+        STALE,          /* of other lamps, replaced as a whole */
+        UPDATE,         /* of another look, updated in place */
+        READY
     };
 
-    enum class colorMode_e : uint8_t
+    struct scene_s
     {
-        HS = 0,
-        CT,
-        XY
+        char id[24];
+        volatile sceneState_e state;
+        uint32_t hash;      /* of the lamps and their on states */
+        uint32_t look;      /* hash of the look it holds, 0 if unknown */
+    };
+
+    /* Registry slots of a lamp combination */
+    struct comboLamps_s
+    {
+        lampMask_t on;
+        lampMask_t off;
+    };
+
+    /* Values the lamps switched on by a combination are set to */
+    struct look_s
+    {
+        uint8_t bri;
+        colorMode_e mode;
+        uint16_t hue;
+        uint8_t sat;
+        uint16_t ct;
+    };
+
+    /* Fields of a lamp bound from the /lights response */
+    enum lampField_e : uint16_t
+    {
+        LAMPFIELD_ON = 0x0001,
+        LAMPFIELD_REACHABLE = 0x0002,
+        LAMPFIELD_BRI = 0x0004,
+        LAMPFIELD_HUE = 0x0008,
+        LAMPFIELD_SAT = 0x0010,
+        LAMPFIELD_CT = 0x0020,
+        LAMPFIELD_COLORMODE = 0x0040,
+        LAMPFIELD_TYPE = 0x0080,
+        LAMPFIELD_GAMUT = 0x0100,
+        LAMPFIELD_CT_RANGE = 0x0200
+    };
+
+    struct lampState_s
+    {
+        bool on;
+        bool reachable;
+        uint8_t bri;
+        uint16_t hue;
+        uint8_t sat;
+        uint16_t ct;
+        colorMode_e mode;
+        uint8_t typeCaps;
+        uint8_t controlCaps;
+
+        uint16_t present;   /* lampField_e of the fields found */
+        uint16_t invalid;   /* lampField_e of the fields with a bad value */
+    };
+
+    enum class bind_e : uint8_t
+    {
+        BOOL = 0,
+        UINT8,
+        UINT16,
+        COLORMODE,
+        TYPE,           /* lamp type string to capabilities */
+        CAPS            /* container presence adds the capabilities */
+    };
+
+    /* Maps a path below a lamp object to a field of lampState_s */
+    struct lampBinding_s
+    {
+        const char* keys[3];
+        uint8_t depth;
+        JsonStream::event_e event;
+        bind_e bind;
+        uint8_t offset;
+        uint8_t caps;
+        uint16_t field;
+    };
+
+    /* State of the streaming extractors between two events */
+    struct lightsParse_s
+    {
+        int32_t slot;
+        lampState_s lamp;
+    };
+
+    struct groupsParse_s
+    {
+        group_s group;
+        bool valid;
+    };
+
+    struct scenesParse_s
+    {
+        char id[sizeof(scene_s::id)];
+        int32_t combo;
+        char hash[9];
+    };
+
+    /* Light states of a scene compared with those it should hold, lamps 
+     * are indexed as in lamps */
+    struct lightstatesParse_s
+    {
+        const RequestGenerator::sceneLamp_s* lamps;
+        uint32_t numLamps;
+        uint16_t present[LampRegistry::MAX_LAMPS];  /* lampField_e */
+        lampMask_t differing;
+    };
+
+    /* Outcome of a request, error is the type of the first error */
+    struct reply_s
+    {
+        bool success;
+        int64_t error;
     };
 
     App();
 
     void setMode(void);
+    void addLamp(uint8_t slot, const lampState_s& lamp);
     void setLampComboMode(void);
-    bool sendRequest(uint8_t firstLamp, uint8_t lastLamp, int32_t requestLen);
+    void runAction(action_e action, int32_t arg);
+    bool getStream(const char* resource, JsonStream& stream);
+    void resolveLampCombos(void);
+    void loadGroups(void);
+    void addGroup(const group_s& group);
+    void loadScenes(void);
+    void addScene(const scenesParse_s& parse);
+    bool uploadScene(int32_t combo);
+    bool createScene(int32_t combo);
+    bool deleteScene(int32_t combo);
+    bool updateScene(int32_t combo);
+    uint32_t sceneLamps(int32_t combo, const look_s& look, 
+            RequestGenerator::sceneLamp_s* lamps) const;
+    void syncScenes(void);
+    look_s look(void) const;
+    static uint32_t lookHash(const look_s& look);
+    uint32_t sceneHash(int32_t combo) const;
+    void checkScenes(void);
+    bool lookSettled(void) const;
+    bool sendCommand(lampMask_t lamps, const lampCommand_s& command);
+    bool sendRequest(lampMask_t lamps, int32_t requestLen);
+    bool sendLampRequest(uint8_t slot, int32_t requestLen);
+    bool sendGroupRequest(uint8_t groupId, int32_t requestLen);
 
+    void probeLamp(uint8_t slot);
+
+    static void lightsEvent(JsonStream& stream, JsonStream::event_e event,
+            void* context);
+    static void bindLampField(const lampBinding_s& binding, 
+            JsonStream& stream, lampState_s& lamp);
+    static void groupsEvent(JsonStream& stream, JsonStream::event_e event,
+            void* context);
+    static void scenesEvent(JsonStream& stream, JsonStream::event_e event,
+            void* context);
+    static void lightstatesEvent(JsonStream& stream, 
+            JsonStream::event_e event, void* context);
+    static void replyEvent(JsonStream& stream, JsonStream::event_e event,
+            void* context);
+
+    static void backgroundTask(void* pParam);
     static void shutdown(TimerHandle_t timer);
 
     bool m_FirstSend;
 
-    uint32_t m_NumLamps;
+    LampRegistry m_Lamps;
     int32_t m_ControlMode;
     int32_t m_LampComboMode;
     colorMode_e m_ColorMode;
@@ -85,12 +284,54 @@ private:
     uint8_t m_Saturation;
     uint16_t m_CT;
 
+    static const uint32_t m_MaxGroups = 16;
+    group_s m_Groups[m_MaxGroups];
+    uint32_t m_NumGroups;
+
+    static const uint32_t m_MaxLampCombos = 8;
+    comboLamps_s m_ComboLamps[m_MaxLampCombos];
+    scene_s m_Scenes[m_MaxLampCombos];
+
+    /* The scenes follow the look once it has not changed for 
+     * m_SceneQuietTime ms */
+    uint32_t m_LookHash;
+    uint32_t m_LookTime;
+    static const uint32_t m_SceneQuietTime = 3000;
+
     char m_ContentBuffer[512];
     char m_WifiSendBuffer[512];
-    char m_WifiRecBuffer[10000];
+    /* Responses are streamed, larger ones arrive in chunks */
+    char m_WifiRecBuffer[512];
+
+    /* Used by the background task only, large enough for a scene of all 
+     * lamps */
+    char m_BackgroundContentBuffer[RequestGenerator::SCENE_BASE_LEN + 
+        LampRegistry::MAX_LAMPS * RequestGenerator::SCENE_LAMP_LEN];
+    char m_BackgroundSendBuffer[sizeof(m_BackgroundContentBuffer) + 256];
+    char m_BackgroundRecBuffer[2048];
+
+    /* Lamp probes are parsed over and over into the same arena */
+    uint8_t m_ProbeArena[1536] __attribute__((aligned(8)));
+    JsonObject m_ProbeJson;
+
+    static const gestureBinding_s m_GestureBindings[];
+    static const uint32_t m_NumGestureBindings;
+
+    static const lampBinding_s m_LampBindings[];
+    static const uint32_t m_NumLampBindings;
+    static const uint16_t m_RequiredLampFields = LAMPFIELD_ON;
 
     TimerHandle_t m_ShutdownTimer;
     static const uint32_t m_ShutdownTimeout = 20000;
+    static const uint32_t m_ProbeInterval = 5000;
+
+    /* Bridge errors returned for a resource that does not exist and for 
+     * parameters of a lamp that is off */
+    static const int64_t m_ErrorNotAvailable = 3;
+    static const int64_t m_ErrorNotModifiable = 201;
+
+    /* The scene handling is tested on the host against a stubbed bridge */
+    friend struct SceneTest;
 };
 
 
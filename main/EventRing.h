@@ -0,0 +1,121 @@
+#ifndef EVENTRING_H
+#define EVENTRING_H
+
+
+#include <stdint.h>
+
+
+/* Lock free ring buffer between a single producer and a single consumer, 
+ * e.g. an interrupt and a task. The head is only written by the producer 
+ * and the tail only by the consumer, both count up and wrap freely. The 
+ * producer claims a slot before it writes it, so the consumer can tell 
+ * whether the item it copied was overwritten meanwhile. */
+template<typename T, uint32_t N>
+class EventRing
+{
+    static_assert((N & (N - 1)) == 0, "The size must be a power of two");
+
+public:
+
+    EventRing() : m_Head(0), m_Claimed(0), m_Tail(0), m_Rejected(0), 
+        m_Overrun(0), m_Peak(0)
+    {}
+
+    /* Producer side, fails if the ring is full */
+    bool push(const T& item)
+    {
+        uint32_t head = m_Head;
+
+        if((head - m_Tail) >= N)
+        {
+            m_Rejected++;
+            return false;
+        }
+
+        m_Claimed = head + 1;
+        barrier();
+        m_Items[head & (N - 1)] = item;
+        barrier();
+        m_Head = head + 1;
+
+        updatePeak(head + 1);
+        return true;
+    }
+
+    /* Producer side, a full ring loses its oldest item */
+    void pushOverwrite(const T& item)
+    {
+        uint32_t head = m_Head;
+
+        m_Claimed = head + 1;
+        barrier();
+        m_Items[head & (N - 1)] = item;
+        barrier();
+        m_Head = head + 1;
+
+        updatePeak(head + 1);
+    }
+
+    /* Consumer side */
+    bool pop(T* item)
+    {
+        uint32_t tail = m_Tail;
+
+        while(true)
+        {
+            uint32_t head = m_Head;
+            if(head == tail) return false;
+
+            /* Skip what the producer has overwritten or is writing */
+            uint32_t claimed = m_Claimed;
+            if((claimed - tail) > N)
+            {
+                m_Overrun += (claimed - tail) - N;
+                tail = claimed - N;
+            }
+
+            *item = m_Items[tail & (N - 1)];
+            barrier();
+
+            /* The slot may have been claimed while it was read. A full 
+             * ring that is not written to is still read completely. */
+            if((m_Claimed - tail) <= N) break;
+        }
+
+        m_Tail = tail + 1;
+        return true;
+    }
+
+    uint32_t depth(void) const { return m_Head - m_Tail; }
+
+    /* Items refused by push() and lost by pushOverwrite() */
+    uint32_t rejected(void) const { return m_Rejected; }
+    uint32_t overrun(void) const { return m_Overrun; }
+    uint32_t peak(void) const { return m_Peak; }
+
+private:
+
+    static void barrier(void) { __asm__ __volatile__("" ::: "memory"); }
+
+    void updatePeak(uint32_t head)
+    {
+        uint32_t depth = head - m_Tail;
+        if(depth > N) depth = N;
+
+        if(depth > m_Peak) m_Peak = depth;
+    }
+
+    T m_Items[N];
+
+    volatile uint32_t m_Head;
+    volatile uint32_t m_Claimed;    /* one ahead of the head during a write */
+    volatile uint32_t m_Tail;
+
+    /* Each counter has a single writer */
+    uint32_t m_Rejected;            /* producer */
+    volatile uint32_t m_Overrun;    /* consumer */
+    uint32_t m_Peak;                /* producer */
+};
+
+
+#endif /* EVENTRING_H */
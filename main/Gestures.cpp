@@ -0,0 +1,132 @@
+#include "Gestures.h"
+
+#include <string.h>
+
+
+Gestures::Gestures(callback_t callback, void* context) :
+    m_Callback(callback),
+    m_Context(context),
+    m_DoubleMask(0),
+    m_ChordFirst(NO_BUTTON),
+    m_ChordSecond(NO_BUTTON)
+{
+    memset(m_Buttons, 0, sizeof(m_Buttons));
+}
+
+
+void Gestures::setDoubleButtons(uint32_t mask)
+{
+    m_DoubleMask = mask;
+}
+
+
+void Gestures::setChord(uint32_t first, uint32_t second)
+{
+    m_ChordFirst = first;
+    m_ChordSecond = second;
+}
+
+
+void Gestures::press(uint32_t button, bool pressed, uint32_t time, 
+        uint16_t trace)
+{
+    if(button >= MAX_BUTTONS) return;
+
+    /* Events may be handled late, what timed out before them comes first */
+    poll(time);
+
+    button_s& b = m_Buttons[button];
+
+    if(pressed == false)
+    {
+        if(b.state != STATE_DOWN)
+        {
+            b.state = STATE_IDLE;
+            return;
+        }
+
+        if(m_DoubleMask & (1 << button))
+        {
+            b.state = STATE_RELEASED;
+            b.time = time;
+            b.trace = trace;
+            return;
+        }
+
+        b.state = STATE_IDLE;
+        m_Callback(button, GESTURE_SHORT, trace, m_Context);
+        return;
+    }
+
+    uint32_t partner = (button == m_ChordFirst) ? m_ChordSecond : 
+        ((button == m_ChordSecond) ? m_ChordFirst : NO_BUTTON);
+
+    /* The other chord button is still down and undecided */
+    if((partner < MAX_BUTTONS) && (m_Buttons[partner].state == STATE_DOWN))
+    {
+        m_Buttons[partner].state = STATE_DONE;
+        b.state = STATE_DONE;
+        m_Callback(m_ChordFirst, GESTURE_CHORD, trace, m_Context);
+        return;
+    }
+
+    if(b.state == STATE_RELEASED)
+    {
+        b.state = STATE_DONE;
+        m_Callback(button, GESTURE_DOUBLE, trace, m_Context);
+        return;
+    }
+
+    b.state = STATE_DOWN;
+    b.time = time;
+    b.trace = trace;
+}
+
+
+void Gestures::poll(uint32_t now)
+{
+    for(uint32_t button = 0; button < MAX_BUTTONS; button++)
+    {
+        button_s& b = m_Buttons[button];
+
+        if((b.state == STATE_DOWN) && 
+            (remaining(m_LongTime, b.time, now) == 0))
+        {
+            b.state = STATE_DONE;
+            m_Callback(button, GESTURE_LONG, b.trace, m_Context);
+        }
+        else if((b.state == STATE_RELEASED) && 
+            (remaining(m_DoubleTime, b.time, now) == 0))
+        {
+            b.state = STATE_IDLE;
+            m_Callback(button, GESTURE_SHORT, b.trace, m_Context);
+        }
+    }
+}
+
+
+uint32_t Gestures::timeout(uint32_t now) const
+{
+    uint32_t timeout = UINT32_MAX;
+
+    for(uint32_t button = 0; button < MAX_BUTTONS; button++)
+    {
+        const button_s& b = m_Buttons[button];
+        uint32_t left = UINT32_MAX;
+
+        if(b.state == STATE_DOWN) left = remaining(m_LongTime, b.time, now);
+        else if(b.state == STATE_RELEASED) 
+            left = remaining(m_DoubleTime, b.time, now);
+
+        if(left < timeout) timeout = left;
+    }
+
+    return timeout;
+}
+
+
+uint32_t Gestures::remaining(uint32_t limit, uint32_t start, uint32_t now)
+{
+    uint32_t elapsed = now - start;
+    return (elapsed < limit) ? (limit - elapsed) : 0;
+}
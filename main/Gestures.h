@@ -0,0 +1,77 @@
+#ifndef GESTURES_H
+#define GESTURES_H
+
+
+#include <stdint.h>
+
+
+/* Recognizes short, long and double presses of buttons and a chord of two 
+ * of them from their debounced press and release events. Gestures that 
+ * are decided by time passing without an event are reported by poll(), 
+ * timeout() tells when it is due. Times are in ms. */
+class Gestures
+{
+public:
+
+    enum gesture_e : uint8_t
+    {
+        GESTURE_SHORT = 0,  /* released before m_LongTime */
+        GESTURE_LONG,       /* held for m_LongTime, reported while held */
+        GESTURE_DOUBLE,     /* pressed again within m_DoubleTime */
+        GESTURE_CHORD       /* both chord buttons down at once */
+    };
+
+    static const uint32_t MAX_BUTTONS = 8;
+    static const uint32_t NO_BUTTON = 0xFF;
+
+    /* A chord is reported for its first button. trace is that of the 
+     * event which completed the gesture. */
+    typedef void (*callback_t)(uint32_t button, gesture_e gesture, 
+            uint16_t trace, void* context);
+
+    Gestures(callback_t callback, void* context);
+
+    /* Buttons in the mask wait m_DoubleTime after a release for a second 
+     * press, the others report a short press right away */
+    void setDoubleButtons(uint32_t mask);
+    void setChord(uint32_t first, uint32_t second);
+
+    void press(uint32_t button, bool pressed, uint32_t time, uint16_t trace);
+    void poll(uint32_t now);
+
+    /* ms until poll() may report a gesture, UINT32_MAX if none is open */
+    uint32_t timeout(uint32_t now) const;
+
+private:
+
+    enum state_e : uint8_t
+    {
+        STATE_IDLE = 0,
+        STATE_DOWN,         /* short, long or chord is open */
+        STATE_RELEASED,     /* short or double is open */
+        STATE_DONE          /* reported, the release is ignored */
+    };
+
+    struct button_s
+    {
+        state_e state;
+        uint16_t trace;
+        uint32_t time;
+    };
+
+    static const uint32_t m_LongTime = 600;
+    static const uint32_t m_DoubleTime = 250;
+
+    static uint32_t remaining(uint32_t limit, uint32_t start, uint32_t now);
+
+    callback_t m_Callback;
+    void* m_Context;
+
+    button_s m_Buttons[MAX_BUTTONS];
+    uint32_t m_DoubleMask;
+    uint8_t m_ChordFirst;
+    uint8_t m_ChordSecond;
+};
+
+
+#endif /* GESTURES_H */
@@ -1,6 +1,10 @@
 #include "Input.h"
 
 #include "App.h"
+#include "SliderFilter.h"
+#include "SliderPredictor.h"
+#include "esp8266.h"
+#include "Trace.h"
 
 #include <driver/adc.h>
 #include <driver/gpio.h>
@@ -9,7 +13,6 @@
 
 #include <FreeRTOS.h>
 #include <task.h>
-#include <queue.h>
 
 
 #define GPIO_BUTTON_TOP     GPIO_NUM_14
@@ -21,10 +24,56 @@
 
 #define SOURCE_ADC          0xFF
 
+#define ADC_MAX             1023
+
+/* A resting slider wakes up after this many consecutive samples at least 
+ * ADC_WAKE_THRESHOLD raw steps away from the last reported value */
+#define ADC_WAKE_THRESHOLD  8
+#define ADC_WAKE_SAMPLES    2
+
+/* Lead time of the slider prediction in ms, 0 sends the current value */
+#ifdef CONFIG_SLIDER_PREDICTION
+#define PREDICTION_LEAD     CONFIG_SLIDER_PREDICTION_LEAD
+#else
+#define PREDICTION_LEAD     0
+#endif
+
+/* The ADC task runs the float filter, the predictor and a debug log with 
+ * printf formatting, which alone takes about 1 KB. The free stack is kept 
+ * in the ADC statistics. */
+#define ADC_TASK_STACK      2048
+
 #define LOG_TAG             "Input"
 
 
-static xQueueHandle eventQueue = NULL;
+static TaskHandle_t adcTaskHandle = NULL;
+static TaskHandle_t eventTaskHandle = NULL;
+
+/* Milliseconds between two slider samples */
+static volatile uint32_t samplePeriod = 1000 / CONFIG_SLIDER_IDLE_RATE;
+
+/* Set by the app for the active control mode */
+static uint32_t sliderSteps = ADC_MAX + 1;
+static uint32_t sliderHysteresis = 0;
+
+Input::pin_s Input::m_Pins[] = 
+{
+    {GPIO_BUTTON_TOP},
+    {GPIO_BUTTON_MIDDLE},
+    {GPIO_BUTTON_BOTTOM},
+    {GPIO_SWITCH_LEFT},
+    {GPIO_SWITCH_RIGHT}
+};
+
+const uint32_t Input::m_NumPins = sizeof(m_Pins)/sizeof(m_Pins[0]);
+
+EventRing<Input::event_s, Input::m_GpioRingSize> Input::m_GpioEvents;
+EventRing<Input::event_s, Input::m_AdcRingSize> Input::m_AdcEvents;
+
+Gestures Input::m_Gestures(Input::gesture, nullptr);
+
+static Input::adcStats_s adcStatistics = {};
+static uint32_t adcModeStart = 0;
 
 
 void Input::init(void)
@@ -38,7 +87,7 @@ void Input::init(void)
     gpioConf.mode = GPIO_MODE_INPUT;
     gpioConf.pull_up_en = GPIO_PULLUP_ENABLE;
     gpioConf.pull_down_en = GPIO_PULLDOWN_DISABLE;
-    gpioConf.intr_type = GPIO_INTR_NEGEDGE;
+    gpioConf.intr_type = GPIO_INTR_ANYEDGE;
     ESP_ERROR_CHECK(gpio_config(&gpioConf));
 
     /* Init switch */
@@ -47,7 +96,7 @@ void Input::init(void)
     gpioConf.mode = GPIO_MODE_INPUT;
     gpioConf.pull_up_en = GPIO_PULLUP_ENABLE;
     gpioConf.pull_down_en = GPIO_PULLDOWN_DISABLE;
-    gpioConf.intr_type = GPIO_INTR_NEGEDGE;
+    gpioConf.intr_type = GPIO_INTR_ANYEDGE;
     ESP_ERROR_CHECK(gpio_config(&gpioConf));
 
     /* Init slider */
@@ -56,134 +105,467 @@ void Input::init(void)
     adcConf.clk_div = 8; // ADC sample collection clock = 80MHz/clk_div = 10MHz
     ESP_ERROR_CHECK(adc_init(&adcConf));
 
-    /* Init interrupt queue */
-    eventQueue = xQueueCreate(20, sizeof(event_s));
-
-    /* Init GPIO interrupts */
+    /* Init GPIO interrupts, the pins are low while pressed */
     ESP_ERROR_CHECK(gpio_install_isr_service(0));
-    ESP_ERROR_CHECK(gpio_isr_handler_add(GPIO_BUTTON_TOP, interrupt, (void*)GPIO_BUTTON_TOP));
-    ESP_ERROR_CHECK(gpio_isr_handler_add(GPIO_BUTTON_MIDDLE, interrupt, (void*)GPIO_BUTTON_MIDDLE));
-    ESP_ERROR_CHECK(gpio_isr_handler_add(GPIO_BUTTON_BOTTOM, interrupt, (void*)GPIO_BUTTON_BOTTOM));
-    ESP_ERROR_CHECK(gpio_isr_handler_add(GPIO_SWITCH_LEFT, interrupt, (void*)GPIO_SWITCH_LEFT));
-    ESP_ERROR_CHECK(gpio_isr_handler_add(GPIO_SWITCH_RIGHT, interrupt, (void*)GPIO_SWITCH_RIGHT));
+    for(uint32_t i = 0; i < m_NumPins; i++)
+    {
+        gpio_num_t gpio = (gpio_num_t)m_Pins[i].gpio;
+
+        m_Pins[i].pressed = (gpio_get_level(gpio) == 0);
+        ESP_ERROR_CHECK(gpio_isr_handler_add(gpio, interrupt, &m_Pins[i]));
+    }
+
+    /* Init gestures, a short press only waits for a second one if the app 
+     * uses double presses of the button */
+    m_Gestures.setDoubleButtons(
+        App::instance().gestureButtons(Gestures::GESTURE_DOUBLE));
+    m_Gestures.setChord((uint32_t)button_e::TOP, (uint32_t)button_e::MIDDLE);
 
     /* Init task */
-    xTaskCreate(adcTask, "ADC task", 1024, nullptr, 8, nullptr);
-    xTaskCreate(eventTask, "Input task", 16384, nullptr, 8, nullptr);
+    xTaskCreate(adcTask, "ADC task", ADC_TASK_STACK, nullptr, 8, &adcTaskHandle);
+    xTaskCreate(eventTask, "Input task", 16384, nullptr, 8, &eventTaskHandle);
+
+    /* Debounce and sample the slider from the millisecond timer */
+    initMicros();
+    setTickHook(tick, nullptr);
+}
+
+
+void Input::tick(void* pParam)
+{
+    static uint32_t ticks = 0;
+    BaseType_t woken = pdFALSE;
+
+    debounce(millis(), &woken);
+
+    if(++ticks >= samplePeriod)
+    {
+        ticks = 0;
+        vTaskNotifyGiveFromISR(adcTaskHandle, &woken);
+    }
+
+    if(woken == pdTRUE) portYIELD_FROM_ISR();
 }
 
 
 void Input::interrupt(void* pParam)
 {
-    const TickType_t blockTime = 10;
-    static TickType_t lastIsrTme = 0;
-    TickType_t isrTime = xTaskGetTickCount();
+    pin_s* pin = (pin_s*)pParam;
+
+    pin->edgeTime = millis();
+    pin->edgeCycles = getCycleCount();
+    pin->settling = true;
+}
 
-    if((isrTime - lastIsrTme) > blockTime)
+
+void Input::debounce(uint32_t now, BaseType_t* woken)
+{
+    /* Runs in the timer interrupt, the GPIO interrupt can not preempt */
+    for(uint32_t i = 0; i < m_NumPins; i++)
     {
+        pin_s& pin = m_Pins[i];
+
+        if((pin.settling == false) || ((now - pin.edgeTime) < m_DebounceTime)) 
+            continue;
+
+        bool pressed = (gpio_get_level((gpio_num_t)pin.gpio) == 0);
+        if(pressed == pin.pressed)
+        {
+            pin.settling = false;
+            continue;
+        }
+
         event_s event;
-        event.source = (uint8_t)(uint32_t)pParam;
-        event.value = 0;
-        xQueueSendFromISR(eventQueue, &event, nullptr);
+        event.source = pin.gpio;
+        event.value = pressed ? 1 : 0;
+        event.time = pin.edgeTime;
+
+        /* The trace survives retries */
+        if(pin.trace == 0) pin.trace = trace_begin(pin.edgeCycles);
+        event.trace = pin.trace;
+
+        /* A full ring is retried on the next tick */
+        if(m_GpioEvents.push(event) == false) continue;
+
+        pin.trace = 0;
+
+        pin.pressed = pressed;
+        pin.settling = false;
+
+        vTaskNotifyGiveFromISR(eventTaskHandle, woken);
     }
+}
+
+
+Input::adcStats_s Input::adcStats(void)
+{
+    /* Updated by the ADC task */
+    portENTER_CRITICAL();
+    adcStats_s stats = adcStatistics;
+    portEXIT_CRITICAL();
+
+    return stats;
+}
+
+
+Input::queueStats_s Input::queueStats(void)
+{
+    queueStats_s stats;
+    stats.gpioStalls = m_GpioEvents.rejected();
+    stats.gpioPeak = m_GpioEvents.peak();
+    stats.adcDrops = m_AdcEvents.overrun();
+    stats.adcPeak = m_AdcEvents.peak();
 
-    lastIsrTme = isrTime;
+    return stats;
+}
+
+
+void Input::logStats(void)
+{
+    static uint32_t loggedWakes = 0;
+    static uint32_t loggedLosses = 0;
+
+    adcStats_s adc = adcStats();
+    queueStats_s queues = queueStats();
+
+    uint32_t losses = queues.gpioStalls + queues.adcDrops;
+    if((adc.wakes == loggedWakes) && (losses == loggedLosses)) return;
+
+    loggedWakes = adc.wakes;
+    loggedLosses = losses;
+
+    ESP_LOGI(LOG_TAG, "{\"label\":\"input\",\"idle_ms\":%u,"
+        "\"tracking_ms\":%u,\"wakes\":%u,\"wake_latency_ms\":%u,"
+        "\"max_wake_latency_ms\":%u,\"stack_free\":%u,"
+        "\"gpio_stalls\":%u,\"gpio_peak\":%u,\"adc_drops\":%u,"
+        "\"adc_peak\":%u}", adc.idleTime, adc.trackingTime, adc.wakes, 
+        adc.wakeLatency, adc.maxWakeLatency, adc.stackFree, 
+        queues.gpioStalls, queues.gpioPeak, queues.adcDrops, 
+        queues.adcPeak);
+}
+
+
+void Input::setSteps(uint32_t steps, uint32_t hysteresis)
+{
+    if(steps < 2) steps = 2;
+
+    portENTER_CRITICAL();
+    sliderSteps = steps;
+    sliderHysteresis = hysteresis;
+    portEXIT_CRITICAL();
+}
+
+
+static uint32_t quantize(int32_t value, uint32_t steps)
+{
+    if(value < 0) value = 0;
+    if(value > ADC_MAX) value = ADC_MAX;
+
+    return ((uint32_t)value * (steps - 1)) / ADC_MAX;
 }
 
 
 void Input::adcTask(void* pParam)
 {
-    uint16_t newVal = 0, oldVal = 0;
-	uint16_t threshold = 10;
+    SliderFilter filter(CONFIG_SLIDER_TRACKING_RATE);
+    SliderPredictor predictor(CONFIG_SLIDER_TRACKING_RATE / 
+            SliderFilter::DECIMATION);
+    uint16_t sample = 0, newVal = 0, oldVal = 0;
+
+    uint32_t steps = 0;
+    uint32_t step = 0;
+
+    bool tracking = false;
+    uint32_t wakeSamples = 0;
+    uint32_t wakeTime = 0;
+    uint32_t lastChange = 0;
+    bool firstChange = false;
+    bool ahead = false;
+
+    adcModeStart = millis();
 
     while(true)
     {
-        ESP_ERROR_CHECK(adc_read(&newVal));
+        /* Woken by the timer at the sample rate */
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        ESP_ERROR_CHECK(adc_read(&sample));
+        uint32_t readCycles = getCycleCount();
+        uint32_t now = millis();
+
+        /* At rest only a clear move away from the reported value counts, 
+         * single spikes are ignored */
+        if(tracking == false)
+        {
+            if(abs((int32_t)oldVal - sample) < ADC_WAKE_THRESHOLD)
+            {
+                wakeSamples = 0;
+                continue;
+            }
+
+            if(++wakeSamples < ADC_WAKE_SAMPLES) continue;
+
+            wakeSamples = 0;
+            tracking = true;
+            setTracking(true, now);
+
+            filter.reset();
+            predictor.reset();
+            wakeTime = now;
+            lastChange = now;
+            firstChange = true;
+            continue;
+        }
+
+        if(filter.addSample(sample, &newVal) == false) continue;
+
+        /* Ahead of the slider while it moves, exact once it is held */
+        newVal = predictor.update(newVal, PREDICTION_LEAD);
+        bool predicted = predictor.predicting();
+
+        portENTER_CRITICAL();
+        int32_t hysteresis = sliderHysteresis;
+        bool modeChanged = (steps != sliderSteps);
+        steps = sliderSteps;
+        portEXIT_CRITICAL();
+
+        /* A new mode alone is not reported */
+        if(modeChanged) step = quantize(oldVal, steps);
+
+        /* Only report once the slider is clearly in another output step. 
+         * A predicted step is corrected without hysteresis. */
+        bool correct = ahead && (predicted == false);
+        if(correct)
+        {
+            ahead = false;
+            oldVal = newVal;
+        }
+
+        if((step < quantize((int32_t)newVal - hysteresis, steps)) || 
+            (step > quantize((int32_t)newVal + hysteresis, steps)) ||
+            (correct && (step != quantize(newVal, steps))))
+        {
+            step = quantize(newVal, steps);
 
-        //ESP_LOGI(LOG_TAG, "Diff: %d\n", (int32_t)oldVal - newVal);
-		if(abs((int32_t)oldVal - newVal) > threshold)
-		{
             event_s event;
             event.source = SOURCE_ADC;
-            event.value = newVal;
-            xQueueSend(eventQueue, &event, 10);
+            event.value = step;
+            event.time = now;
+            event.trace = trace_begin(readCycles);
+            m_AdcEvents.pushOverwrite(event);
+            xTaskNotifyGive(eventTaskHandle);
+
+            oldVal = newVal;
+            lastChange = now;
+            ahead = predicted;
 
-			oldVal = newVal;
-		}
+            if(firstChange)
+            {
+                firstChange = false;
 
-        vTaskDelay(200 / portTICK_PERIOD_MS);
+                adcStatistics.wakeLatency = now - wakeTime;
+                if(adcStatistics.wakeLatency > adcStatistics.maxWakeLatency)
+                    adcStatistics.maxWakeLatency = adcStatistics.wakeLatency;
+            }
+        }
+        else if((now - lastChange) >= CONFIG_SLIDER_QUIET_TIME)
+        {
+            tracking = false;
+            setTracking(false, now);
+        }
     }
 }
 
 
+void Input::setTracking(bool tracking, uint32_t now)
+{
+    /* The time is booked to the mode that ends */
+    if(tracking)
+    {
+        adcStatistics.idleTime += now - adcModeStart;
+        adcStatistics.wakes++;
+        samplePeriod = 1000 / CONFIG_SLIDER_TRACKING_RATE;
+    }
+    else
+    {
+        adcStatistics.trackingTime += now - adcModeStart;
+        samplePeriod = 1000 / CONFIG_SLIDER_IDLE_RATE;
+
+        /* Runs on the ADC task at the end of a tracking phase, the mark 
+         * covers the filter, the predictor and the logs of earlier phases */
+        adcStatistics.stackFree = uxTaskGetStackHighWaterMark(nullptr);
+
+        ESP_LOGD(LOG_TAG, "Slider idle: %d ms idle, %d ms tracking, "
+            "%d wakes, wake latency %d ms (max %d ms), %d bytes stack free", 
+            adcStatistics.idleTime, adcStatistics.trackingTime, 
+            adcStatistics.wakes, adcStatistics.wakeLatency, 
+            adcStatistics.maxWakeLatency, adcStatistics.stackFree);
+    }
+
+    adcModeStart = now;
+}
+
+
+static bool isSwitch(uint8_t source)
+{
+    return (source == GPIO_SWITCH_LEFT) || (source == GPIO_SWITCH_RIGHT);
+}
+
+
 void Input::eventTask(void* pParam)
 {
-    event_s event;
+    event_s gpioEvents[m_GpioRingSize];
+    event_s adcEvents[m_AdcRingSize];
+    uint32_t adcDrops = 0;
 
     while(true)
     {
-        if(xQueueReceive(eventQueue, &event, portMAX_DELAY) == pdFALSE)
+        /* Open gestures are decided by time as well */
+        uint32_t timeout = m_Gestures.timeout(millis());
+        ulTaskNotifyTake(pdTRUE, (timeout == UINT32_MAX) ? portMAX_DELAY : 
+            (pdMS_TO_TICKS(timeout) + 1));
+
+        /* Take everything queued so far, later events wake the task again */
+        uint32_t numGpio = 0;
+        while((numGpio < m_GpioRingSize) && 
+            m_GpioEvents.pop(&gpioEvents[numGpio])) numGpio++;
+
+        uint32_t numAdc = 0;
+        while((numAdc < m_AdcRingSize) && 
+            m_AdcEvents.pop(&adcEvents[numAdc])) numAdc++;
+
+        handleBatch(gpioEvents, numGpio, adcEvents, numAdc);
+        m_Gestures.poll(millis());
+        trace_set_current(0);
+
+        if(m_AdcEvents.overrun() != adcDrops)
+        {
+            adcDrops = m_AdcEvents.overrun();
+            ESP_LOGD(LOG_TAG, "%d slider values dropped, peak depth %d", 
+                adcDrops, m_AdcEvents.peak());
+        }
+    }
+}
+
+
+void Input::handleBatch(const event_s* gpioEvents, uint32_t numGpio, 
+        const event_s* adcEvents, uint32_t numAdc)
+{
+    uint32_t gpio = 0, adc = 0;
+
+    /* Events are handled in the order they happened. The slider values 
+     * between two GPIO events only take effect with the last of them, a 
+     * mode switch in between still splits them. */
+    while((gpio < numGpio) || (adc < numAdc))
+    {
+        bool adcFirst = (gpio == numGpio) || ((adc < numAdc) && 
+            ((int32_t)(adcEvents[adc].time - gpioEvents[gpio].time) <= 0));
+
+        if(adcFirst == false)
         {
+            const event_s& event = gpioEvents[gpio++];
+
+            /* Presses of the same switch in a row are passed on at once, 
+             * button gestures need every press and release */
+            uint32_t presses = event.value;
+            while(isSwitch(event.source) && (gpio < numGpio) && 
+                (gpioEvents[gpio].source == event.source) && ((adc == numAdc) || 
+                ((int32_t)(gpioEvents[gpio].time - adcEvents[adc].time) < 0)))
+            {
+                presses += gpioEvents[gpio++].value;
+            }
+
+            handleEvent(event, presses);
             continue;
         }
 
-        if(event.source == SOURCE_ADC)
+        uint32_t last = adc;
+        while((last + 1 < numAdc) && ((gpio == numGpio) || 
+            ((int32_t)(adcEvents[last + 1].time - gpioEvents[gpio].time) <= 0)))
+            last++;
+
+        if(last > adc)
+        {
+            ESP_LOGD(LOG_TAG, "%d slider values collapsed", last - adc);
+        }
+
+        handleEvent(adcEvents[last], 1);
+        adc = last + 1;
+    }
+}
+
+
+void Input::handleEvent(const event_s& event, uint32_t count)
+{
+    trace_set_current(event.trace);
+    trace_mark(TRACE_EVENT);
+
+    switch(event.source)
+    {
+        case SOURCE_ADC:
         {
-            ESP_LOGI(LOG_TAG, "Adc %d", event.value);
+            ESP_LOGI(LOG_TAG, "Slider step %d", event.value);
             App::instance().newAdVal(event.value);
+            break;
         }
-        else
+
+        case GPIO_BUTTON_TOP:
         {
-            vTaskDelay(20 / portTICK_PERIOD_MS);
+            m_Gestures.press((uint32_t)button_e::TOP, count > 0, event.time, 
+                event.trace);
+            break;
+        }
 
-            if(gpio_get_level((gpio_num_t)event.source) != 0)
-            {
-                continue;
-            }
+        case GPIO_BUTTON_MIDDLE:
+        {
+            m_Gestures.press((uint32_t)button_e::MIDDLE, count > 0, 
+                event.time, event.trace);
+            break;
+        }
 
-            switch(event.source)
-            {
-                case GPIO_BUTTON_TOP:
-                {
-                    ESP_LOGI(LOG_TAG, "Btn top");
-                    App::instance().buttonPress(button_e::TOP);
-                    break;
-                }
-
-                case GPIO_BUTTON_MIDDLE:
-                {
-                    ESP_LOGI(LOG_TAG, "Btn middle");
-                    App::instance().buttonPress(button_e::MIDDLE);
-                    break;
-                }
-
-                case GPIO_BUTTON_BOTTOM:
-                {
-                    ESP_LOGI(LOG_TAG, "Btn bottom");
-                    App::instance().buttonPress(button_e::BOTTOM);
-                    break;
-                }
-
-                case GPIO_SWITCH_LEFT:
-                {
-                    ESP_LOGI(LOG_TAG, "Switch left");
-                    App::instance().switchAction(switch_e::LEFT);
-                    break;
-                }
-
-                case GPIO_SWITCH_RIGHT:
-                {
-                    ESP_LOGI(LOG_TAG, "Switch right");
-                    App::instance().switchAction(switch_e::RIGHT);
-                    break;
-                }
-
-                default:
-                {
-                    ESP_LOGI(LOG_TAG, "Unknown source");
-                    break;
-                }
-            }
+        case GPIO_BUTTON_BOTTOM:
+        {
+            m_Gestures.press((uint32_t)button_e::BOTTOM, count > 0, 
+                event.time, event.trace);
+            break;
+        }
+
+        case GPIO_SWITCH_LEFT:
+        {
+            /* Releases are not acted on */
+            if(count == 0) break;
+
+            ESP_LOGI(LOG_TAG, "Switch left");
+            App::instance().switchAction(switch_e::LEFT, count);
+            break;
+        }
+
+        case GPIO_SWITCH_RIGHT:
+        {
+            if(count == 0) break;
+
+            ESP_LOGI(LOG_TAG, "Switch right");
+            App::instance().switchAction(switch_e::RIGHT, count);
+            break;
+        }
+
+        default:
+        {
+            ESP_LOGI(LOG_TAG, "Unknown source");
+            break;
         }
     }
+}
+
+
+void Input::gesture(uint32_t button, Gestures::gesture_e gesture, 
+        uint16_t trace, void* context)
+{
+    static const char* const names[] = {"short", "long", "double", "chord"};
+
+    /* Gestures decided by time are traced from their last event */
+    trace_set_current(trace);
+
+    ESP_LOGI(LOG_TAG, "Btn %d %s", button, names[gesture]);
+    App::instance().buttonGesture((button_e)button, gesture);
 }
\ No newline at end of file
@@ -4,24 +4,102 @@
 
 #include <stdint.h>
 
+#include "EventRing.h"
+#include "Gestures.h"
+
+#include "FreeRTOS.h"
+
 
 class Input
 {
 public:
 
+    /* Time the slider was sampled at each rate and the delay from noticing
+     * a move to reporting the first value */
+    struct adcStats_s
+    {
+        uint32_t idleTime;
+        uint32_t trackingTime;
+        uint32_t wakes;
+        uint32_t wakeLatency;       /* of the last wake, in ms */
+        uint32_t maxWakeLatency;
+        uint32_t stackFree;         /* least free stack of the ADC task */
+    };
+
+    /* Button events are never dropped, a full ring stalls the debounce of 
+     * the pin instead. The slider drops its oldest values. */
+    struct queueStats_s
+    {
+        uint32_t gpioStalls;
+        uint32_t gpioPeak;
+        uint32_t adcDrops;
+        uint32_t adcPeak;
+    };
+
     static void init(void);
 
+    static adcStats_s adcStats(void);
+    static queueStats_s queueStats(void);
+
+    /* Logs the statistics as one line of JSON if the slider was used or an 
+     * event was lost since the last line */
+    static void logStats(void);
+
+    /* Quantizes the slider to the given number of output values, a change 
+     * is reported once the slider is hysteresis raw steps into the next 
+     * value */
+    static void setSteps(uint32_t steps, uint32_t hysteresis);
+
 private:
 
+    /* The value of a slider event is the step set with setSteps(), that of 
+     * a GPIO event 1 for a press and 0 for a release. Times are in ms. */
     struct event_s
     {
         uint8_t source;
         uint16_t value;
+        uint16_t trace;
+        uint32_t time;
     };
 
+    /* Debounce state of a button or switch. Edges only restart the 
+     * settling time, the level is taken once it has been stable for 
+     * m_DebounceTime. */
+    struct pin_s
+    {
+        uint8_t gpio;
+        volatile bool settling;
+        volatile uint32_t edgeTime;
+        volatile uint32_t edgeCycles;
+        bool pressed;
+        uint16_t trace;
+    };
+
+    static const uint32_t m_DebounceTime = 20;
+
+    static pin_s m_Pins[];
+    static const uint32_t m_NumPins;
+
+    static const uint32_t m_GpioRingSize = 16;
+    static const uint32_t m_AdcRingSize = 8;
+
+    static EventRing<event_s, m_GpioRingSize> m_GpioEvents;
+    static EventRing<event_s, m_AdcRingSize> m_AdcEvents;
+
     static void interrupt(void* pParam);
+    static void tick(void* pParam);
+    static void debounce(uint32_t now, BaseType_t* woken);
     static void adcTask(void* pParam);
+    static void setTracking(bool tracking, uint32_t now);
     static void eventTask(void* pParam);
+    static void handleBatch(const event_s* gpioEvents, uint32_t numGpio, 
+            const event_s* adcEvents, uint32_t numAdc);
+    /* count is the number of presses of a GPIO event */
+    static void handleEvent(const event_s& event, uint32_t count);
+    static void gesture(uint32_t button, Gestures::gesture_e gesture, 
+            uint16_t trace, void* context);
+
+    static Gestures m_Gestures;
 };
 
 
@@ -2,15 +2,252 @@
 
 #include <esp_log.h>
 
+#include "esp8266.h"
+
+#include <FreeRTOS.h>
+
 #include <stdio.h>
+#include <stdlib.h>
 
 
 #define LOG_TAG "JsonObject"
 
+/* A tree takes about two and a half times the size of its JSON text. Only 
+ * single lamp replies are parsed into trees, the large collections are 
+ * streamed. Larger trees fall back to the heap. */
+#define ARENA_SIZE  (4 * 1024)
+#define ARENA_ALIGN 8
+
+/* The profile costs two micros() calls per parse and lookup, it is only 
+ * kept with CONFIG_JSON_PROFILE */
+#ifdef CONFIG_JSON_PROFILE
+#define PROFILE(statement)  statement
+#else
+#define PROFILE(statement)
+#endif
+
+
+static uint32_t hashKey(const char* key, uint32_t* length);
+static const char* skipWhitespace(const char* pos, const char* end);
+static const char* skipString(const char* pos, const char* end);
+static const char* skipValue(const char* pos, const char* end);
+
+
+/* Static memory the trees are allocated from, one tree at a time */
+static uint8_t arena[ARENA_SIZE] __attribute__((aligned(ARENA_ALIGN)));
+
+bool JsonObject::m_ArenaBusy = false;
+uint32_t JsonObject::m_ArenaHighWater = 0;
+
+JsonObject::profile_s JsonObject::m_Profile = {};
+
 
 JsonObject::JsonObject(const char* jsonString)
 {
-    m_Root = json_parse(jsonString, strlen(jsonString));
+    initArena(nullptr, 0);
+    init(false);
+    m_ArenaStats.parses++;
+    parse(jsonString, strlen(jsonString));
+}
+
+
+JsonObject::JsonObject(char* jsonBuffer, uint32_t length, bool lazy)
+{
+    initArena(nullptr, 0);
+    load(jsonBuffer, length, lazy);
+}
+
+
+JsonObject::JsonObject(uint8_t* arenaBuffer, uint32_t size)
+{
+    initArena(arenaBuffer, size);
+    init(true);
+}
+
+
+JsonObject::~JsonObject()
+{
+    release();
+}
+
+
+bool JsonObject::reparse(char* jsonBuffer, uint32_t length, bool lazy)
+{
+    release();
+    load(jsonBuffer, length, lazy);
+
+    return (m_Root != nullptr) || (m_NumMembers > 0);
+}
+
+
+void JsonObject::initArena(uint8_t* arenaBuffer, uint32_t size)
+{
+    m_OwnArena = (arenaBuffer != nullptr);
+    m_Arena = m_OwnArena ? arenaBuffer : arena;
+
+    m_ArenaStats = {};
+    m_ArenaStats.capacity = m_OwnArena ? size : ARENA_SIZE;
+}
+
+
+void JsonObject::load(char* jsonBuffer, uint32_t length, bool lazy)
+{
+    init(true);
+    m_ArenaStats.parses++;
+
+    if(lazy && scanMembers(jsonBuffer, length))
+    {
+        claimArena();
+        return;
+    }
+
+    parse(jsonBuffer, length);
+}
+
+
+void JsonObject::release(void)
+{
+    if(m_NumMembers > 0)
+    {
+        uint32_t parsed = 0;
+        for(uint32_t i = 0; i < m_NumMembers; i++)
+        {
+            if(m_Members[i].value != nullptr) parsed += m_Members[i].length;
+        }
+
+        ESP_LOGD(LOG_TAG, "Lazy parse: %d bytes parsed, %d bytes skipped", 
+            parsed, m_MembersLength - parsed);
+    }
+
+    /* The arena is released as a whole */
+    if(m_UsesArena)
+    {
+        ESP_LOGD(LOG_TAG, "Arena used %d bytes, high water %d bytes", 
+            m_ArenaStats.used, m_ArenaStats.highWater);
+
+        if(m_OwnArena == false) m_ArenaBusy = false;
+
+        init(m_InSitu);
+        return;
+    }
+
+    PROFILE(if(m_HeapBytes > m_Profile.heapPeak) 
+        m_Profile.heapPeak = m_HeapBytes);
+
+    while(m_HeapIndexes != nullptr)
+    {
+        keyIndex_s* next = m_HeapIndexes->next;
+        free(m_HeapIndexes);
+        m_HeapIndexes = next;
+    }
+
+    json_settings settings = {};
+    settings.settings = m_InSitu ? json_in_situ : 0;
+    settings.mem_free = heapFree;
+
+    json_value_free_ex(&settings, m_Root);
+
+    for(uint32_t i = 0; i < m_NumMembers; i++)
+    {
+        json_value_free_ex(&settings, m_Members[i].value);
+    }
+
+    init(m_InSitu);
+}
+
+
+void JsonObject::init(bool inSitu)
+{
+    m_Root = nullptr;
+    m_UsesArena = false;
+    m_InSitu = inSitu;
+    m_HeapIndexes = nullptr;
+    m_HeapBytes = 0;
+    m_NumMembers = 0;
+    m_MembersLength = 0;
+}
+
+
+void JsonObject::claimArena(void)
+{
+    /* Fall back to the heap if another tree holds the shared arena */
+    if(m_OwnArena)
+    {
+        m_UsesArena = true;
+    }
+    else
+    {
+        portENTER_CRITICAL();
+        if(m_ArenaBusy == false)
+        {
+            m_ArenaBusy = true;
+            m_UsesArena = true;
+        }
+        portEXIT_CRITICAL();
+    }
+
+    if(m_UsesArena) m_ArenaStats.used = 0;
+}
+
+
+json_value* JsonObject::parseTree(const char* json, uint32_t length)
+{
+    json_settings settings = {};
+    settings.settings = m_InSitu ? json_in_situ : 0;
+    settings.value_extra = sizeof(keyIndex_s*);
+    settings.user_data = this;
+
+    if(m_UsesArena)
+    {
+        settings.mem_alloc = arenaAlloc;
+        settings.mem_free = arenaFree;
+    }
+    else
+    {
+        settings.mem_alloc = heapAlloc;
+        settings.mem_free = heapFree;
+    }
+
+    PROFILE(uint32_t start = micros());
+    json_value* value = json_parse_ex(&settings, json, length, nullptr);
+
+    PROFILE(m_Profile.parses++);
+    PROFILE(m_Profile.parsedBytes += length);
+    PROFILE(m_Profile.parseMicros += micros() - start);
+
+    return value;
+}
+
+
+void JsonObject::parse(const char* json, uint32_t length)
+{
+    claimArena();
+
+    if(m_UsesArena)
+    {
+        m_Root = parseTree(json, length);
+
+        if(m_Root == nullptr)
+        {
+            ESP_LOGW(LOG_TAG, "Arena parse failed after %d bytes", 
+                m_ArenaStats.used);
+
+            if(m_OwnArena == false) m_ArenaBusy = false;
+            m_UsesArena = false;
+
+            /* The text may have been unescaped in place already */
+            if(m_InSitu)
+            {
+                ESP_LOGE(LOG_TAG, "Unable to parse JSON in situ!");
+                return;
+            }
+        }
+    }
+
+    if(m_Root == nullptr)
+    {
+        m_Root = parseTree(json, length);
+    }
 
     if(m_Root == nullptr)
     {
@@ -19,74 +256,156 @@ JsonObject::JsonObject(const char* jsonString)
 }
 
 
-JsonObject::~JsonObject()
+bool JsonObject::scanMembers(char* json, uint32_t length)
 {
-    json_value_free(m_Root);
+    PROFILE(uint32_t start = micros());
+    bool found = scanRoot(json, length);
+    PROFILE(m_Profile.parseMicros += micros() - start);
+
+    return found;
 }
 
 
-bool JsonObject::getBool(const char** path, const uint32_t depth, 
-        bool* returnValue)
+bool JsonObject::scanRoot(char* json, uint32_t length)
 {
-    json_value* jsonValue;
+    const char* end = json + length;
+    const char* pos = skipWhitespace(json, end);
+
+    if((pos == end) || (*pos != '{')) return false;
+    pos = skipWhitespace(pos + 1, end);
+
+    char* keyEnds[m_MaxMembers];
+
+    while((pos != end) && (*pos != '}'))
+    {
+        if(m_NumMembers >= m_MaxMembers) break;
+
+        if(m_NumMembers > 0)
+        {
+            if(*pos != ',') break;
+            pos = skipWhitespace(pos + 1, end);
+        }
 
-    if(getObject(path, depth, &jsonValue) == false) return false;
+        if((pos == end) || (*pos != '"')) break;
+
+        member_s& member = m_Members[m_NumMembers];
+        member.key = json + (pos - json) + 1;
+
+        const char* keyEnd = skipString(pos, end);
+        if(keyEnd == nullptr) break;
+
+        keyEnds[m_NumMembers] = json + (keyEnd - json) - 1;
+        member.keyLength = keyEnds[m_NumMembers] - member.key;
+
+        pos = skipWhitespace(keyEnd, end);
+        if((pos == end) || (*pos != ':')) break;
+        pos = skipWhitespace(pos + 1, end);
+
+        const char* valueEnd = skipValue(pos, end);
+        if(valueEnd == nullptr) break;
+
+        member.start = json + (pos - json);
+        member.length = valueEnd - pos;
+        member.value = nullptr;
+        m_MembersLength += member.length;
+        m_NumMembers++;
+
+        pos = skipWhitespace(valueEnd, end);
+    }
+
+    /* Anything unexpected is left to the full parser */
+    if((pos == end) || (*pos != '}') || (m_NumMembers == 0))
+    {
+        m_NumMembers = 0;
+        m_MembersLength = 0;
+        return false;
+    }
 
-    if(jsonValue->type != json_boolean) return false;
+    /* The keys are terminated in place only now, the text is still intact 
+     * if the scan fails */
+    for(uint32_t i = 0; i < m_NumMembers; i++) *keyEnds[i] = '\0';
 
-    *returnValue = jsonValue->u.boolean;
     return true;
 }
 
 
-bool JsonObject::getInt(const char** path, const uint32_t depth, 
-        int64_t* returnValue)
+json_value* JsonObject::lazyMember(const char* key, uint32_t keyLength)
+{
+    for(uint32_t i = 0; i < m_NumMembers; i++)
+    {
+        member_s& member = m_Members[i];
+
+        if((member.keyLength != keyLength) || 
+            (memcmp(member.key, key, keyLength) != 0)) continue;
+
+        /* Materialize the subtree on the first descent */
+        if(member.value == nullptr)
+        {
+            member.value = parseTree(member.start, member.length);
+
+            if(member.value == nullptr)
+            {
+                ESP_LOGE(LOG_TAG, "Unable to parse member %s!", member.key);
+            }
+        }
+
+        return member.value;
+    }
+
+    return nullptr;
+}
+
+
+bool JsonObject::getBool(const char** path, const uint32_t depth, 
+        bool* returnValue, cursor_t from)
 {
     json_value* jsonValue;
 
-    if(getObject(path, depth, &jsonValue) == false) return false;
+    if(getObject(path, depth, &jsonValue, from) == false) return false;
 
-    if(jsonValue->type != json_integer) return false;
+    return convert(jsonValue, returnValue);
+}
 
-    *returnValue = jsonValue->u.integer;
-    return true;
+
+bool JsonObject::getInt(const char** path, const uint32_t depth, 
+        int64_t* returnValue, cursor_t from)
+{
+    json_value* jsonValue;
+
+    if(getObject(path, depth, &jsonValue, from) == false) return false;
+
+    return convert(jsonValue, returnValue);
 }
 
 
 bool JsonObject::getDouble(const char** path, const uint32_t depth, 
-        double* returnValue)
+        double* returnValue, cursor_t from)
 {
     json_value* jsonValue;
 
-    if(getObject(path, depth, &jsonValue) == false) return false;
+    if(getObject(path, depth, &jsonValue, from) == false) return false;
 
-    if(jsonValue->type != json_double) return false;
-
-    *returnValue = jsonValue->u.dbl;
-    return true;
+    return convert(jsonValue, returnValue);
 }
 
 
 bool JsonObject::getString(const char** path, const uint32_t depth, 
-        char** returnValue)
+        char** returnValue, cursor_t from)
 {
     json_value* jsonValue;
 
-    if(getObject(path, depth, &jsonValue) == false) return false;
-
-    if(jsonValue->type != json_string) return false;
+    if(getObject(path, depth, &jsonValue, from) == false) return false;
 
-    *returnValue = jsonValue->u.string.ptr;
-    return true;
+    return convert(jsonValue, returnValue);
 }
 
 
 bool JsonObject::getNumObjects(const char** path, 
-        const uint32_t depth, uint32_t* returnValue)
+        const uint32_t depth, uint32_t* returnValue, cursor_t from)
 {
     json_value* jsonValue;
 
-    if(getObject(path, depth, &jsonValue) == false) return false;
+    if(getObject(path, depth, &jsonValue, from) == false) return false;
 
     if(jsonValue->type != json_object) return false;
 
@@ -95,45 +414,300 @@ bool JsonObject::getNumObjects(const char** path,
 }
 
 
+bool JsonObject::getCursor(const char** path, const uint32_t depth,
+        cursor_t* returnValue, cursor_t from)
+{
+    return getObject(path, depth, returnValue, from);
+}
+
+
 void JsonObject::print(void)
 {
     printValue(m_Root, 0);
 }
 
 
+void JsonObject::resetProfile(void)
+{
+    m_Profile = {};
+}
+
+
+void JsonObject::logProfile(const char* label)
+{
+#ifdef CONFIG_JSON_PROFILE
+    const profile_s& p = m_Profile;
+
+    ESP_LOGI(LOG_TAG, "{\"label\":\"%s\",\"parses\":%u,\"bytes\":%u,"
+        "\"parse_us\":%u,\"arena_allocs\":%u,\"arena_peak\":%u,"
+        "\"heap_allocs\":%u,\"heap_peak\":%u,\"lookups\":%u,"
+        "\"lookup_us\":%u}", label, p.parses, p.parsedBytes, p.parseMicros, 
+        p.arenaAllocs, m_ArenaHighWater, p.heapAllocs, p.heapPeak, 
+        p.lookups, p.lookupMicros);
+#endif
+}
+
+
+bool JsonObject::convert(const json_value* value, bool* returnValue)
+{
+    if(value->type != json_boolean) return false;
+
+    *returnValue = value->u.boolean;
+    return true;
+}
+
+
+bool JsonObject::convert(const json_value* value, int64_t* returnValue)
+{
+    if(value->type != json_integer) return false;
+
+    *returnValue = value->u.integer;
+    return true;
+}
+
+
+bool JsonObject::convert(const json_value* value, double* returnValue)
+{
+    if(value->type != json_double) return false;
+
+    *returnValue = value->u.dbl;
+    return true;
+}
+
+
+bool JsonObject::convert(const json_value* value, char** returnValue)
+{
+    if(value->type != json_string) return false;
+
+    *returnValue = value->u.string.ptr;
+    return true;
+}
+
+
 bool JsonObject::getObject(const char** path, const uint32_t depth, 
-        json_value** returnValue)
+        json_value** returnValue, json_value* from)
 {
-    json_value* jsonValue = m_Root;
+    PROFILE(uint32_t start = micros());
+    PROFILE(m_Profile.lookups++);
+
+    json_value* jsonValue = (from != nullptr) ? from : m_Root;
 
     for(uint32_t currentDepth = 0; currentDepth < depth; currentDepth++)
     {
-        if(jsonValue == nullptr) return false;
+        uint32_t keyLength;
+        uint32_t hash = hashKey(path[currentDepth], &keyLength);
+
+        /* The root of a lazy tree is not parsed */
+        if((currentDepth == 0) && (from == nullptr) && (m_NumMembers > 0))
+        {
+            jsonValue = lazyMember(path[currentDepth], keyLength);
+            continue;
+        }
+
+        if(jsonValue == nullptr) break;
+
+        jsonValue = findChild(jsonValue, path[currentDepth], keyLength, hash);
+    }
+
+    PROFILE(m_Profile.lookupMicros += micros() - start);
+
+    if(jsonValue == nullptr) return false;
+
+    *returnValue = jsonValue;
+    return true;
+}
+
 
-        if(jsonValue->type != json_object) return false;
+bool JsonObject::getObject(const JsonKey* keys, const uint32_t depth, 
+        json_value** returnValue, json_value* from)
+{
+    PROFILE(uint32_t start = micros());
+    PROFILE(m_Profile.lookups++);
 
-        uint32_t objLength = jsonValue->u.object.length;
+    json_value* jsonValue = (from != nullptr) ? from : m_Root;
 
-        bool nextValueFound = false;
-        for(uint32_t i = 0; i < objLength; i++)
+    for(uint32_t currentDepth = 0; currentDepth < depth; currentDepth++)
+    {
+        const JsonKey& key = keys[currentDepth];
+
+        /* The root of a lazy tree is not parsed */
+        if((currentDepth == 0) && (from == nullptr) && (m_NumMembers > 0))
         {
-            if(strcmp(path[currentDepth], 
-                jsonValue->u.object.values[i].name) == 0)
-            {
-                jsonValue = jsonValue->u.object.values[i].value;
-                nextValueFound = true;
-                break;
-            }
+            jsonValue = lazyMember(key.name, key.length);
+            continue;
         }
 
-        if(nextValueFound == false) return false;
+        if(jsonValue == nullptr) break;
+
+        jsonValue = findChild(jsonValue, key.name, key.length, key.hash);
     }
 
+    PROFILE(m_Profile.lookupMicros += micros() - start);
+
+    if(jsonValue == nullptr) return false;
+
     *returnValue = jsonValue;
     return true;
 }
 
 
+json_value* JsonObject::findChild(json_value* value, const char* key, 
+        uint32_t keyLength, uint32_t hash)
+{
+    /* Array elements are addressed by their decimal index */
+    if(value->type == json_array)
+    {
+        char* indexEnd;
+        uint32_t index = strtoul(key, &indexEnd, 10);
+
+        if((*indexEnd != '\0') || (index >= value->u.array.length)) 
+            return nullptr;
+
+        return value->u.array.values[index];
+    }
+
+    if(value->type != json_object) return nullptr;
+
+    uint32_t length = value->u.object.length;
+
+    /* Small objects are scanned */
+    if(length >= m_IndexMinMembers)
+    {
+        /* The index pointer lives in the extra space behind the value */
+        keyIndex_s*& index = *(keyIndex_s**)(value + 1);
+        if(index == nullptr) index = buildIndex(value);
+
+        if(index != nullptr)
+        {
+            uint16_t* buckets = (uint16_t*)(index + 1);
+
+            for(uint32_t pos = hash & index->mask; buckets[pos] != 0; 
+                pos = (pos + 1) & index->mask)
+            {
+                json_object_entry& member = 
+                    value->u.object.values[buckets[pos] - 1];
+
+                if((member.name_length == keyLength) && 
+                    (memcmp(member.name, key, keyLength) == 0)) 
+                    return member.value;
+            }
+
+            return nullptr;
+        }
+    }
+
+    for(uint32_t i = 0; i < length; i++)
+    {
+        json_object_entry& member = value->u.object.values[i];
+
+        if((member.name_length == keyLength) && 
+            (memcmp(member.name, key, keyLength) == 0)) 
+            return member.value;
+    }
+
+    return nullptr;
+}
+
+
+JsonObject::keyIndex_s* JsonObject::buildIndex(json_value* object)
+{
+    uint32_t length = object->u.object.length;
+    if(length > UINT16_MAX) return nullptr;
+
+    /* Keep the table at most half full */
+    uint32_t numBuckets = 16;
+    while(numBuckets < 2 * length) numBuckets <<= 1;
+
+    uint32_t size = sizeof(keyIndex_s) + numBuckets * sizeof(uint16_t);
+
+    keyIndex_s* index;
+    if(m_UsesArena)
+    {
+        index = (keyIndex_s*)arenaAlloc(size, 1, this);
+    }
+    else
+    {
+        /* Heap indexes are chained to be freed with the tree */
+        index = (keyIndex_s*)heapAlloc(size, 1, this);
+        if(index != nullptr)
+        {
+            index->next = m_HeapIndexes;
+            m_HeapIndexes = index;
+        }
+    }
+
+    /* Lookups fall back to a scan */
+    if(index == nullptr) return nullptr;
+
+    index->mask = numBuckets - 1;
+    uint16_t* buckets = (uint16_t*)(index + 1);
+
+    for(uint32_t i = 0; i < length; i++)
+    {
+        const json_object_entry& member = object->u.object.values[i];
+
+        uint32_t keyLength;
+        uint32_t pos = hashKey(member.name, &keyLength) & index->mask;
+        while(buckets[pos] != 0) pos = (pos + 1) & index->mask;
+
+        buckets[pos] = i + 1;
+    }
+
+    return index;
+}
+
+
+void* JsonObject::arenaAlloc(size_t size, int zero, void* userData)
+{
+    JsonObject* object = (JsonObject*)userData;
+    arenaStats_s& stats = object->m_ArenaStats;
+
+    size = (size + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+
+    if(size > (stats.capacity - stats.used))
+    {
+        stats.overflows++;
+        return nullptr;
+    }
+
+    void* ptr = &object->m_Arena[stats.used];
+    stats.used += size;
+
+    if(stats.used > stats.highWater) stats.highWater = stats.used;
+
+    if((object->m_OwnArena == false) && (stats.used > m_ArenaHighWater)) 
+        m_ArenaHighWater = stats.used;
+
+    PROFILE(m_Profile.arenaAllocs++);
+
+    if(zero) memset(ptr, 0, size);
+
+    return ptr;
+}
+
+
+void JsonObject::arenaFree(void* ptr, void* userData)
+{
+    /* Single allocations are never returned */
+}
+
+
+void* JsonObject::heapAlloc(size_t size, int zero, void* userData)
+{
+    /* Sizes are summed per tree, frees are not tracked */
+    ((JsonObject*)userData)->m_HeapBytes += size;
+    PROFILE(m_Profile.heapAllocs++);
+
+    return zero ? calloc(1, size) : malloc(size);
+}
+
+
+void JsonObject::heapFree(void* ptr, void* userData)
+{
+    free(ptr);
+}
+
+
 void JsonObject::printValue(json_value* value, uint32_t depth)
 {
     if(value == nullptr) return;
@@ -212,3 +786,107 @@ void JsonObject::printDepthShift(uint32_t depth)
         printf(" ");
     }
 }
+
+
+static uint32_t hashKey(const char* key, uint32_t* length)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261U;
+    const char* c = key;
+
+    while(*c != '\0')
+    {
+        hash ^= (uint8_t)*c++;
+        hash *= 16777619U;
+    }
+
+    *length = c - key;
+    return hash;
+}
+
+
+static const char* skipWhitespace(const char* pos, const char* end)
+{
+    while((pos != end) && 
+        ((*pos == ' ') || (*pos == '\t') || (*pos == '\r') || (*pos == '\n')))
+        pos++;
+
+    return pos;
+}
+
+
+static const char* skipString(const char* pos, const char* end)
+{
+    /* pos is on the opening quote, the position behind the closing one is 
+     * returned */
+    for(pos++; pos != end; pos++)
+    {
+        if(*pos == '\\')
+        {
+            if(++pos == end) return nullptr;
+        }
+        else if(*pos == '"')
+        {
+            return pos + 1;
+        }
+    }
+
+    return nullptr;
+}
+
+
+static const char* skipValue(const char* pos, const char* end)
+{
+    if(pos == end) return nullptr;
+
+    if(*pos == '"') return skipString(pos, end);
+
+    /* Scalars end at the next delimiter */
+    if((*pos != '{') && (*pos != '['))
+    {
+        const char* start = pos;
+        while((pos != end) && (*pos != ',') && (*pos != '}') && 
+            (*pos != ']') && (*pos != ' ') && (*pos != '\t') && 
+            (*pos != '\r') && (*pos != '\n')) pos++;
+
+        return (pos != start) ? pos : nullptr;
+    }
+
+    /* Containers are skipped by counting brackets outside of strings */
+    uint32_t nesting = 0;
+    while(pos != end)
+    {
+        switch(*pos)
+        {
+            case '"':
+            {
+                pos = skipString(pos, end);
+                if(pos == nullptr) return nullptr;
+                continue;
+            }
+
+            case '{':
+            case '[':
+            {
+                nesting++;
+                break;
+            }
+
+            case '}':
+            case ']':
+            {
+                if(--nesting == 0) return pos + 1;
+                break;
+            }
+
+            default:
+            {
+                break;
+            }
+        }
+
+        pos++;
+    }
+
+    return nullptr;
+}
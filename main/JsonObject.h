@@ -5,34 +5,201 @@
 #include "json.h"
 
 
+/* Key of a path with its length and FNV-1a hash, computed at compile time 
+ * when constructed from a literal */
+class JsonKey
+{
+public:
+
+    constexpr JsonKey(const char* name) :
+        name(name), length(lengthOf(name)), hash(hashOf(name, 2166136261U))
+    {}
+
+    const char* name;
+    uint32_t length;
+    uint32_t hash;
+
+private:
+
+    static constexpr uint32_t lengthOf(const char* key)
+    {
+        return (*key == '\0') ? 0 : 1 + lengthOf(key + 1);
+    }
+
+    static constexpr uint32_t hashOf(const char* key, uint32_t hash)
+    {
+        return (*key == '\0') ? hash : 
+            hashOf(key + 1, (hash ^ (uint8_t)*key) * 16777619U);
+    }
+};
+
+
+template<uint32_t N>
+struct JsonPath
+{
+    JsonKey keys[N];
+};
+
+
+/* e.g. static constexpr auto briPath = jsonPath("state", "bri"); */
+template<typename... Keys>
+constexpr JsonPath<sizeof...(Keys)> jsonPath(Keys... keys)
+{
+    return JsonPath<sizeof...(Keys)>{{JsonKey(keys)...}};
+}
+
+
 class JsonObject
 {
 public:
 
+    /* A position in the tree. Paths given together with a cursor are 
+     * relative to it, without one they start at the root. */
+    typedef json_value* cursor_t;
+
     JsonObject(const char* jsonString);
+
+    /* Parses in situ, the strings returned point into the buffer. A lazy 
+     * tree only records where the members of the root object are and 
+     * parses a member on the first lookup that descends into it. The root 
+     * of a lazy tree can not be queried itself. */
+    JsonObject(char* jsonBuffer, uint32_t length, bool lazy = false);
+
+    /* A reusable object with its own arena, aligned to 8 bytes. It is 
+     * empty until reparse() is called. Size the arena by the high water 
+     * mark, trees that do not fit are counted as overflows. */
+    JsonObject(uint8_t* arenaBuffer, uint32_t size);
     ~JsonObject();
 
+    /* Replaces the tree by one parsed in situ from the buffer, the arena 
+     * is reused. Returns false if nothing could be parsed. */
+    bool reparse(char* jsonBuffer, uint32_t length, bool lazy = false);
+
     bool getBool(const char** path, const uint32_t depth, 
-            bool* returnValue);
+            bool* returnValue, cursor_t from = nullptr);
 
     bool getInt(const char** path, const uint32_t depth, 
-            int64_t* returnValue);
+            int64_t* returnValue, cursor_t from = nullptr);
 
     bool getDouble(const char** path, const uint32_t depth, 
-            double* returnValue);
+            double* returnValue, cursor_t from = nullptr);
 
     bool getString(const char** path, const uint32_t depth, 
-            char** returnValue);
+            char** returnValue, cursor_t from = nullptr);
 
     bool getNumObjects(const char** path, const uint32_t depth,
-            uint32_t* returnValue);
+            uint32_t* returnValue, cursor_t from = nullptr);
+
+    bool getCursor(const char** path, const uint32_t depth,
+            cursor_t* returnValue, cursor_t from = nullptr);
+
+    /* Resolves a whole path with precomputed keys. T is one of bool, 
+     * int64_t, double and char*, other types do not compile. */
+    template<typename T, uint32_t N>
+    bool get(const JsonPath<N>& path, T* returnValue, 
+            cursor_t from = nullptr)
+    {
+        json_value* jsonValue;
+
+        if(getObject(path.keys, N, &jsonValue, from) == false) return false;
+
+        return convert(jsonValue, returnValue);
+    }
+
+    template<uint32_t N>
+    bool getCursor(const JsonPath<N>& path, cursor_t* returnValue, 
+            cursor_t from = nullptr)
+    {
+        return getObject(path.keys, N, returnValue, from);
+    }
 
     void print(void);
 
+    static uint32_t arenaHighWater(void) { return m_ArenaHighWater; }
+
+    struct arenaStats_s
+    {
+        uint32_t capacity;
+        uint32_t used;          /* by the current tree */
+        uint32_t highWater;
+        uint32_t parses;
+        uint32_t overflows;     /* allocations that did not fit */
+    };
+
+    const arenaStats_s& arenaStats(void) const { return m_ArenaStats; }
+
+    /* Cost of all trees since boot or the last reset, only counted with 
+     * CONFIG_JSON_PROFILE */
+    struct profile_s
+    {
+        uint32_t parses;
+        uint32_t parsedBytes;
+        uint32_t parseMicros;
+        uint32_t arenaAllocs;
+        uint32_t heapAllocs;
+        uint32_t heapPeak;      /* largest heap footprint of a single tree */
+        uint32_t lookups;
+        uint32_t lookupMicros;  /* includes lazy member parses */
+    };
+
+    static const profile_s& profile(void) { return m_Profile; }
+    static void resetProfile(void);
+
+    /* Logs the profile as one line of JSON so runs can be compared */
+    static void logProfile(const char* label);
+
 private:
 
+    /* Open addressing table of the member indexes plus one, built on the 
+     * first lookup in a large object */
+    struct keyIndex_s
+    {
+        keyIndex_s* next;
+        uint32_t mask;
+    };
+
+    static const uint32_t m_IndexMinMembers = 8;
+
+    /* Unparsed member of the root object of a lazy tree */
+    struct member_s
+    {
+        const char* key;
+        uint32_t keyLength;
+        const char* start;
+        uint32_t length;
+        json_value* value;
+    };
+
+    static const uint32_t m_MaxMembers = 24;
+
+    static void* arenaAlloc(size_t size, int zero, void* userData);
+    static void arenaFree(void* ptr, void* userData);
+    static void* heapAlloc(size_t size, int zero, void* userData);
+    static void heapFree(void* ptr, void* userData);
+
+    void initArena(uint8_t* arenaBuffer, uint32_t size);
+    void init(bool inSitu);
+    void load(char* jsonBuffer, uint32_t length, bool lazy);
+    void release(void);
+    void claimArena(void);
+    json_value* parseTree(const char* json, uint32_t length);
+    void parse(const char* json, uint32_t length);
+    bool scanMembers(char* json, uint32_t length);
+    bool scanRoot(char* json, uint32_t length);
+    json_value* lazyMember(const char* key, uint32_t keyLength);
+
+    static bool convert(const json_value* value, bool* returnValue);
+    static bool convert(const json_value* value, int64_t* returnValue);
+    static bool convert(const json_value* value, double* returnValue);
+    static bool convert(const json_value* value, char** returnValue);
+
     bool getObject(const char** path, const uint32_t depth, 
-            json_value** returnValue);
+            json_value** returnValue, json_value* from);
+    bool getObject(const JsonKey* keys, const uint32_t depth, 
+            json_value** returnValue, json_value* from);
+    json_value* findChild(json_value* value, const char* key, 
+            uint32_t keyLength, uint32_t hash);
+    keyIndex_s* buildIndex(json_value* object);
 
     void printValue(json_value* value, uint32_t depth);
     void printObject(json_value* value, uint32_t depth);
@@ -40,6 +207,23 @@ private:
     void printDepthShift(uint32_t depth);
 
     json_value* m_Root;
+    uint8_t* m_Arena;
+    bool m_OwnArena;
+    bool m_UsesArena;
+    bool m_InSitu;
+    keyIndex_s* m_HeapIndexes;
+    uint32_t m_HeapBytes;
+
+    member_s m_Members[m_MaxMembers];
+    uint32_t m_NumMembers;
+    uint32_t m_MembersLength;
+
+    arenaStats_s m_ArenaStats;
+
+    static bool m_ArenaBusy;
+    static uint32_t m_ArenaHighWater;
+
+    static profile_s m_Profile;
 };
 
 
@@ -0,0 +1,478 @@
+#include "JsonStream.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+#define IS_WHITESPACE(c)    (((c) == ' ') || ((c) == '\t') || \
+                                ((c) == '\r') || ((c) == '\n'))
+
+#define IS_LITERAL_CHAR(c)  ((((c) >= '0') && ((c) <= '9')) || \
+                                (((c) >= 'a') && ((c) <= 'z')) || \
+                                (((c) >= 'A') && ((c) <= 'Z')) || \
+                                ((c) == '-') || ((c) == '+') || ((c) == '.'))
+
+#define IS_DIGIT(c)         (((c) >= '0') && ((c) <= '9'))
+
+#define IS_HEX_DIGIT(c)     (IS_DIGIT(c) || (((c) >= 'a') && ((c) <= 'f')) || \
+                                (((c) >= 'A') && ((c) <= 'F')))
+
+
+static bool isNumber(const char* value);
+
+
+JsonStream::JsonStream(callback_t callback, void* context)
+{
+    m_Callback = callback;
+    m_Context = context;
+
+    reset();
+}
+
+
+void JsonStream::reset(void)
+{
+    m_State = STATE_START;
+    m_Type = TYPE_STRING;
+    m_UnicodeLeft = 0;
+    m_Depth = 0;
+    m_ArrayBits = 0;
+    m_KeyLen = 0;
+    m_ValueLen = 0;
+    m_Value[0] = '\0';
+}
+
+
+bool JsonStream::feed(const char* data, uint32_t len)
+{
+    for(uint32_t i = 0; i < len; i++)
+    {
+        char c = data[i];
+
+        switch(m_State)
+        {
+            case STATE_START:
+            {
+                if(c == '{') beginContainer(false);
+                else if(c == '[') beginContainer(true);
+                break;
+            }
+
+            case STATE_VALUE_OR_END:
+            {
+                if(IS_WHITESPACE(c)) break;
+
+                if(c == ']')
+                {
+                    if(endContainer(true) == false) return false;
+                    break;
+                }
+
+                if(beginValue(c) == false) return false;
+                break;
+            }
+
+            case STATE_VALUE:
+            {
+                if(IS_WHITESPACE(c)) break;
+
+                if(beginValue(c) == false) return false;
+                break;
+            }
+
+            case STATE_KEY_OR_END:
+            {
+                if(IS_WHITESPACE(c)) break;
+
+                if(c == '}')
+                {
+                    if(endContainer(false) == false) return false;
+                    break;
+                }
+
+                if(c != '"')
+                {
+                    m_State = STATE_ERROR;
+                    return false;
+                }
+
+                beginKey();
+                break;
+            }
+
+            case STATE_KEY_START:
+            {
+                if(IS_WHITESPACE(c)) break;
+
+                if(c != '"')
+                {
+                    m_State = STATE_ERROR;
+                    return false;
+                }
+
+                beginKey();
+                break;
+            }
+
+            case STATE_KEY:
+            {
+                if(c == '\\') m_State = STATE_KEY_ESCAPE;
+                else if(c == '"') m_State = STATE_COLON;
+                else appendKey(c);
+                break;
+            }
+
+            case STATE_KEY_ESCAPE:
+            {
+                /* Keys of interest never contain escapes, keep the raw
+                 * character */
+                appendKey(c);
+                m_State = STATE_KEY;
+                break;
+            }
+
+            case STATE_COLON:
+            {
+                if(IS_WHITESPACE(c)) break;
+
+                if(c != ':')
+                {
+                    m_State = STATE_ERROR;
+                    return false;
+                }
+
+                m_State = STATE_VALUE;
+                break;
+            }
+
+            case STATE_STRING:
+            {
+                if(c == '\\') m_State = STATE_STRING_ESCAPE;
+                else if(c == '"') endValue();
+                else appendValue(c);
+                break;
+            }
+
+            case STATE_STRING_ESCAPE:
+            {
+                switch(c)
+                {
+                    case 'b': appendValue('\b'); break;
+                    case 'f': appendValue('\f'); break;
+                    case 'n': appendValue('\n'); break;
+                    case 'r': appendValue('\r'); break;
+                    case 't': appendValue('\t'); break;
+
+                    /* Unicode escapes are not decoded */
+                    case 'u':
+                    {
+                        appendValue('?');
+                        m_UnicodeLeft = 4;
+                        m_State = STATE_UNICODE;
+                        continue;
+                    }
+
+                    default: appendValue(c); break;
+                }
+
+                m_State = STATE_STRING;
+                break;
+            }
+
+            case STATE_UNICODE:
+            {
+                if(IS_HEX_DIGIT(c) == false)
+                {
+                    m_State = STATE_ERROR;
+                    return false;
+                }
+
+                if(--m_UnicodeLeft == 0) m_State = STATE_STRING;
+                break;
+            }
+
+            case STATE_LITERAL:
+            {
+                if(IS_LITERAL_CHAR(c))
+                {
+                    appendValue(c);
+                    break;
+                }
+
+                if(endValue() == false) return false;
+
+                /* The terminating character belongs to the container */
+                i--;
+                break;
+            }
+
+            case STATE_NEXT:
+            {
+                if(IS_WHITESPACE(c)) break;
+
+                if(c == ',')
+                {
+                    nextElement();
+                    break;
+                }
+
+                if(((c == '}') || (c == ']')) && endContainer(c == ']'))
+                    break;
+
+                m_State = STATE_ERROR;
+                return false;
+            }
+
+            case STATE_DONE:
+            {
+                /* Trailing data is ignored */
+                return true;
+            }
+
+            case STATE_ERROR:
+            default:
+            {
+                return false;
+            }
+        }
+
+        if(m_State == STATE_ERROR) return false;
+    }
+
+    return true;
+}
+
+
+bool JsonStream::finish(void)
+{
+    if(m_State != STATE_DONE) m_State = STATE_ERROR;
+
+    return done();
+}
+
+
+const char* JsonStream::key(uint32_t level) const
+{
+    if((level >= m_Depth) || (level >= MAX_DEPTH)) return "";
+
+    return m_Keys[level];
+}
+
+
+bool JsonStream::keyIs(uint32_t level, const char* key) const
+{
+    if((level >= m_Depth) || (level >= MAX_DEPTH)) return false;
+
+    return strcmp(m_Keys[level], key) == 0;
+}
+
+
+bool JsonStream::getInt(int64_t* returnValue) const
+{
+    if(m_Type != TYPE_NUMBER) return false;
+
+    *returnValue = strtoll(m_Value, nullptr, 10);
+    return true;
+}
+
+
+bool JsonStream::getBool(bool* returnValue) const
+{
+    if(m_Type != TYPE_LITERAL) return false;
+
+    if(strcmp(m_Value, "true") == 0) *returnValue = true;
+    else if(strcmp(m_Value, "false") == 0) *returnValue = false;
+    else return false;
+
+    return true;
+}
+
+
+bool JsonStream::beginValue(char c)
+{
+    m_ValueLen = 0;
+    m_Value[0] = '\0';
+
+    if(c == '{') beginContainer(false);
+    else if(c == '[') beginContainer(true);
+    else if(c == '"')
+    {
+        m_Type = TYPE_STRING;
+        m_State = STATE_STRING;
+    }
+    else if(((c >= '0') && (c <= '9')) || (c == '-'))
+    {
+        m_Type = TYPE_NUMBER;
+        m_State = STATE_LITERAL;
+        appendValue(c);
+    }
+    else if((c == 't') || (c == 'f') || (c == 'n'))
+    {
+        m_Type = TYPE_LITERAL;
+        m_State = STATE_LITERAL;
+        appendValue(c);
+    }
+    else
+    {
+        m_State = STATE_ERROR;
+        return false;
+    }
+
+    return true;
+}
+
+
+void JsonStream::beginContainer(bool isArray)
+{
+    if(m_Depth >= MAX_NESTING)
+    {
+        m_State = STATE_ERROR;
+        return;
+    }
+
+    m_Callback(*this, isArray ? EVENT_ARRAY : EVENT_OBJECT, m_Context);
+
+    if(isArray) m_ArrayBits |= (1U << m_Depth);
+    else m_ArrayBits &= ~(1U << m_Depth);
+
+    if(m_Depth < MAX_DEPTH)
+    {
+        m_Index[m_Depth] = 0;
+        strcpy(m_Keys[m_Depth], isArray ? "0" : "");
+    }
+
+    m_Depth++;
+    m_State = isArray ? STATE_VALUE_OR_END : STATE_KEY_OR_END;
+}
+
+
+bool JsonStream::endContainer(bool isArray)
+{
+    bool topIsArray = (m_ArrayBits & (1U << (m_Depth - 1))) != 0;
+    if(topIsArray != isArray)
+    {
+        m_State = STATE_ERROR;
+        return false;
+    }
+
+    m_Depth--;
+    m_State = (m_Depth == 0) ? STATE_DONE : STATE_NEXT;
+
+    return true;
+}
+
+
+bool JsonStream::endValue(void)
+{
+    /* Literals are checked once complete, truncated numbers are taken as 
+     * they are */
+    bool valid = true;
+
+    if(m_Type == TYPE_LITERAL)
+    {
+        valid = (strcmp(m_Value, "true") == 0) || 
+            (strcmp(m_Value, "false") == 0) || (strcmp(m_Value, "null") == 0);
+    }
+    else if(m_Type == TYPE_NUMBER)
+    {
+        valid = valueTruncated() || isNumber(m_Value);
+    }
+
+    if(valid == false)
+    {
+        m_State = STATE_ERROR;
+        return false;
+    }
+
+    m_Callback(*this, EVENT_VALUE, m_Context);
+
+    m_State = STATE_NEXT;
+    return true;
+}
+
+
+void JsonStream::nextElement(void)
+{
+    uint32_t level = m_Depth - 1;
+
+    if((m_ArrayBits & (1U << level)) == 0)
+    {
+        m_State = STATE_KEY_START;
+        return;
+    }
+
+    if(level < MAX_DEPTH)
+    {
+        m_Index[level]++;
+        snprintf(m_Keys[level], sizeof(m_Keys[level]), "%u", m_Index[level]);
+    }
+
+    m_State = STATE_VALUE;
+}
+
+
+void JsonStream::beginKey(void)
+{
+    uint32_t level = m_Depth - 1;
+    if(level < MAX_DEPTH) m_Keys[level][0] = '\0';
+
+    m_KeyLen = 0;
+    m_State = STATE_KEY;
+}
+
+
+void JsonStream::appendKey(char c)
+{
+    uint32_t level = m_Depth - 1;
+    if(level >= MAX_DEPTH) return;
+
+    if(m_KeyLen < MAX_KEY_LEN)
+    {
+        m_Keys[level][m_KeyLen++] = c;
+        m_Keys[level][m_KeyLen] = '\0';
+    }
+}
+
+
+void JsonStream::appendValue(char c)
+{
+    if(m_ValueLen < MAX_VALUE_LEN)
+    {
+        m_Value[m_ValueLen] = c;
+        m_Value[m_ValueLen + 1] = '\0';
+    }
+
+    /* Counting on marks the value as truncated */
+    m_ValueLen++;
+}
+
+
+/* A number as JSON defines it: -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)? */
+static bool isNumber(const char* value)
+{
+    const char* c = value;
+
+    if(*c == '-') c++;
+
+    if(*c == '0') c++;
+    else if(IS_DIGIT(*c)) while(IS_DIGIT(*c)) c++;
+    else return false;
+
+    if(*c == '.')
+    {
+        c++;
+        if(IS_DIGIT(*c) == false) return false;
+        while(IS_DIGIT(*c)) c++;
+    }
+
+    if((*c == 'e') || (*c == 'E'))
+    {
+        c++;
+        if((*c == '+') || (*c == '-')) c++;
+        if(IS_DIGIT(*c) == false) return false;
+        while(IS_DIGIT(*c)) c++;
+    }
+
+    return *c == '\0';
+}
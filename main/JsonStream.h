@@ -0,0 +1,116 @@
+#ifndef JSONSTREAM_H
+#define JSONSTREAM_H
+
+
+#include <stdint.h>
+
+
+/* Event based JSON tokenizer fed with arbitrary chunks of text. Nothing
+ * but the path to the current value is kept, so the memory needed is
+ * independent of the size of the document. Everything before the first
+ * '{' or '[' (e.g. HTTP headers) is skipped. */
+class JsonStream
+{
+public:
+
+    enum event_e : uint8_t
+    {
+        EVENT_VALUE = 0,    /* a string, number or literal was completed */
+        EVENT_OBJECT,       /* an object begins */
+        EVENT_ARRAY         /* an array begins */
+    };
+
+    enum type_e : uint8_t
+    {
+        TYPE_STRING = 0,
+        TYPE_NUMBER,
+        TYPE_LITERAL        /* true, false or null */
+    };
+
+    /* Called for every event. The path to the value or container is
+     * available via depth() and key(), array elements are keyed by their
+     * decimal index. */
+    typedef void (*callback_t)(JsonStream& stream, event_e event,
+            void* context);
+
+    /* Keys and values are truncated to these lengths, keys deeper than
+     * MAX_DEPTH are not stored */
+    static const uint32_t MAX_DEPTH = 6;
+    static const uint32_t MAX_KEY_LEN = 31;
+    static const uint32_t MAX_VALUE_LEN = 31;
+
+    JsonStream(callback_t callback, void* context);
+
+    void reset(void);
+    bool feed(const char* data, uint32_t len);
+
+    /* Ends the document, one that is not complete fails. Returns done(). */
+    bool finish(void);
+
+    bool done(void) const { return m_State == STATE_DONE; }
+    bool failed(void) const { return m_State == STATE_ERROR; }
+
+    uint32_t depth(void) const { return m_Depth; }
+    const char* key(uint32_t level) const;
+    bool keyIs(uint32_t level, const char* key) const;
+
+    type_e type(void) const { return m_Type; }
+    const char* value(void) const { return m_Value; }
+    bool valueTruncated(void) const { return m_ValueLen > MAX_VALUE_LEN; }
+
+    bool getInt(int64_t* returnValue) const;
+    bool getBool(bool* returnValue) const;
+
+private:
+
+    enum state_e : uint8_t
+    {
+        STATE_START = 0,
+        STATE_VALUE,
+        STATE_VALUE_OR_END,
+        STATE_KEY_OR_END,
+        STATE_KEY_START,
+        STATE_KEY,
+        STATE_KEY_ESCAPE,
+        STATE_COLON,
+        STATE_STRING,
+        STATE_STRING_ESCAPE,
+        STATE_UNICODE,
+        STATE_LITERAL,
+        STATE_NEXT,
+        STATE_DONE,
+        STATE_ERROR
+    };
+
+    /* Containers are tracked as a bit stack, set bits are arrays */
+    static const uint32_t MAX_NESTING = 32;
+
+    bool beginValue(char c);
+    void beginContainer(bool isArray);
+    bool endContainer(bool isArray);
+    bool endValue(void);
+    void nextElement(void);
+    void beginKey(void);
+    void appendKey(char c);
+    void appendValue(char c);
+
+    callback_t m_Callback;
+    void* m_Context;
+
+    state_e m_State;
+    type_e m_Type;
+    uint8_t m_UnicodeLeft;
+
+    uint32_t m_Depth;
+    uint32_t m_ArrayBits;
+    uint16_t m_Index[MAX_DEPTH];
+
+    uint8_t m_KeyLen;
+    char m_Keys[MAX_DEPTH][MAX_KEY_LEN + 1];
+
+    uint32_t m_ValueLen;
+    char m_Value[MAX_VALUE_LEN + 1];
+};
+
+
+#endif /* JSONSTREAM_H */
@@ -0,0 +1,84 @@
+#include "LampRegistry.h"
+
+#include <string.h>
+
+
+LampRegistry::LampRegistry()
+{
+    clear();
+}
+
+
+void LampRegistry::clear(void)
+{
+    m_Size = 0;
+    m_All = 0;
+    m_On = 0;
+    m_Reachable = 0;
+
+    memset(m_SlotById, NO_SLOT, sizeof(m_SlotById));
+}
+
+
+int32_t LampRegistry::add(uint32_t lampId)
+{
+    if(lampId > MAX_LAMP_ID) return -1;
+
+    /* Known lamps keep their slot */
+    if(m_SlotById[lampId] != NO_SLOT) return m_SlotById[lampId];
+
+    if(m_Size >= MAX_LAMPS) return -1;
+
+    uint8_t slot = m_Size++;
+
+    m_Id[slot] = lampId;
+    m_Caps[slot] = 0;
+    m_Bri[slot] = 0;
+    m_Hue[slot] = 0;
+    m_Sat[slot] = 0;
+    m_Ct[slot] = 0;
+    m_Mode[slot] = colorMode_e::NONE;
+
+    m_SlotById[lampId] = slot;
+    m_All |= LAMP(slot);
+
+    return slot;
+}
+
+
+int32_t LampRegistry::slot(uint32_t lampId) const
+{
+    if(lampId > MAX_LAMP_ID) return -1;
+    if(m_SlotById[lampId] == NO_SLOT) return -1;
+
+    return m_SlotById[lampId];
+}
+
+
+lampMask_t LampRegistry::fromIds(const uint8_t* ids, uint32_t numIds) const
+{
+    lampMask_t lamps = 0;
+
+    for(uint32_t i = 0; i < numIds; i++)
+    {
+        uint8_t slot = m_SlotById[ids[i]];
+        if((ids[i] != 0) && (slot != NO_SLOT)) lamps |= LAMP(slot);
+    }
+
+    return lamps;
+}
+
+
+void LampRegistry::setOn(lampMask_t lamps, bool on)
+{
+    if(on) m_On |= lamps & m_All;
+    else m_On &= ~lamps;
+}
+
+
+void LampRegistry::setReachable(lampMask_t lamps, bool reachable)
+{
+    if(reachable) m_Reachable |= lamps & m_All;
+    else m_Reachable &= ~lamps;
+}
+
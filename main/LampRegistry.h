@@ -0,0 +1,91 @@
+#ifndef LAMPREGISTRY_H
+#define LAMPREGISTRY_H
+
+
+#include <stdint.h>
+
+
+/* Bit n of a lamp mask stands for the lamp in registry slot n */
+typedef uint64_t lampMask_t;
+
+#define LAMP(n)                     ((lampMask_t)1 << (n))
+#define LAMP_RANGE(first, last)     ((~(lampMask_t)0 >> (63 - (last))) & \
+                                        ~(LAMP(first) - 1))
+#define LAMPS_ALL                   (~(lampMask_t)0)
+
+
+enum class colorMode_e : uint8_t
+{
+    HS = 0,
+    CT,
+    XY,
+    NONE
+};
+
+
+/* Fixed size registry of the lamps known to the bridge, stored as a 
+ * structure of arrays indexed by slot */
+class LampRegistry
+{
+public:
+
+    static const uint32_t MAX_LAMPS = 64;
+    static const uint32_t MAX_LAMP_ID = 255;
+
+    LampRegistry();
+
+    void clear(void);
+    int32_t add(uint32_t lampId);
+
+    int32_t slot(uint32_t lampId) const;
+    /* Slots of the lamps with the given IDs, unknown IDs and 0 are 
+     * skipped */
+    lampMask_t fromIds(const uint8_t* ids, uint32_t numIds) const;
+
+    uint8_t id(uint8_t slot) const { return m_Id[slot]; }
+    uint32_t size(void) const { return m_Size; }
+    lampMask_t all(void) const { return m_All; }
+
+    uint8_t caps(uint8_t slot) const { return m_Caps[slot]; }
+    void setCaps(uint8_t slot, uint8_t caps) { m_Caps[slot] = caps; }
+
+    lampMask_t on(void) const { return m_On; }
+    void setOn(lampMask_t lamps, bool on);
+
+    lampMask_t reachable(void) const { return m_Reachable; }
+    void setReachable(lampMask_t lamps, bool reachable);
+
+    uint8_t bri(uint8_t slot) const { return m_Bri[slot]; }
+    uint16_t hue(uint8_t slot) const { return m_Hue[slot]; }
+    uint8_t sat(uint8_t slot) const { return m_Sat[slot]; }
+    uint16_t ct(uint8_t slot) const { return m_Ct[slot]; }
+    colorMode_e mode(uint8_t slot) const { return m_Mode[slot]; }
+
+    void setBri(uint8_t slot, uint8_t bri) { m_Bri[slot] = bri; }
+    void setHue(uint8_t slot, uint16_t hue) { m_Hue[slot] = hue; }
+    void setSat(uint8_t slot, uint8_t sat) { m_Sat[slot] = sat; }
+    void setCt(uint8_t slot, uint16_t ct) { m_Ct[slot] = ct; }
+    void setMode(uint8_t slot, colorMode_e mode) { m_Mode[slot] = mode; }
+
+private:
+
+    static const uint8_t NO_SLOT = 0xFF;
+
+    uint32_t m_Size;
+    lampMask_t m_All;
+    lampMask_t m_On;
+    lampMask_t m_Reachable;
+
+    uint8_t m_Id[MAX_LAMPS];
+    uint8_t m_Caps[MAX_LAMPS];
+    uint8_t m_Bri[MAX_LAMPS];
+    uint16_t m_Hue[MAX_LAMPS];
+    uint8_t m_Sat[MAX_LAMPS];
+    uint16_t m_Ct[MAX_LAMPS];
+    colorMode_e m_Mode[MAX_LAMPS];
+
+    uint8_t m_SlotById[MAX_LAMP_ID + 1];
+};
+
+
+#endif /* LAMPREGISTRY_H */
@@ -2,6 +2,7 @@
 
 #include "Adafruit_NeoPixel.h"
 #include "esp8266.h"
+#include "Trace.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
@@ -32,13 +33,20 @@ static const uint8_t ctValues[LED_COUNT][3] =
 static Adafruit_NeoPixel strip(LED_COUNT, LED_PIN, NEO_GRB + NEO_KHZ800);
 
 
+static void show(void)
+{
+    strip.show();
+    trace_mark(TRACE_LED);
+}
+
+
 void LedStrip::init(uint8_t brightness)
 {
     initMicros();
 
     strip.begin();
     strip.setBrightness(brightness);
-    strip.show();
+    show();
 }
 
 
@@ -53,7 +61,7 @@ void LedStrip::showHUE(uint8_t sat)
             strip.ColorHSV(hue, sat, 0xFF));
     }
 
-    strip.show();
+    show();
 }
 
 
@@ -68,7 +76,7 @@ void LedStrip::showSaturation(uint16_t hue)
                 strip.ColorHSV(hue, sat, 0xFF));
     }
 
-    strip.show();
+    show();
 }
 
 
@@ -83,7 +91,7 @@ void LedStrip::showBrightness(uint16_t hue, uint8_t sat)
                 strip.ColorHSV(hue, sat, bri));
     }
 
-    strip.show();
+    show();
 }
 
 
@@ -97,7 +105,7 @@ void LedStrip::showBrightness(uint16_t ct)
         strip.setPixelColor(n, colorCT(ct, bri));
     }
 
-    strip.show();
+    show();
 }
 
 
@@ -111,7 +119,7 @@ void LedStrip::showColorTemperature(void)
             ctValues[n][2]);
     }
 
-    strip.show();
+    show();
 }
 
 
@@ -122,7 +130,7 @@ void LedStrip::showColor(uint16_t hue)
         strip.setPixelColor(n, strip.ColorHSV(hue));
     }
 
-    strip.show();
+    show();
 }
 
 
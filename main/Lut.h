@@ -0,0 +1,52 @@
+#ifndef LUT_H
+#define LUT_H
+
+
+#include <stdint.h>
+
+
+/* Lookup table filled at compile time, value i is F(i, N). 
+ * e.g. static constexpr auto lut = makeLut<uint8_t, 256, curve>(); */
+template<typename T, uint32_t N>
+struct Lut
+{
+    T values[N];
+
+    constexpr T operator[](uint32_t index) const 
+    { 
+        return values[(index < N) ? index : N - 1]; 
+    }
+
+    static constexpr uint32_t size(void) { return N; }
+};
+
+
+/* Index sequence to expand the table, C++11 has none of its own */
+template<uint32_t... I>
+struct LutIndexes {};
+
+template<uint32_t N, uint32_t... I>
+struct MakeLutIndexes : MakeLutIndexes<N - 1, N - 1, I...> {};
+
+template<uint32_t... I>
+struct MakeLutIndexes<0, I...>
+{
+    typedef LutIndexes<I...> type;
+};
+
+
+template<typename T, uint32_t N, T (*F)(uint32_t, uint32_t), uint32_t... I>
+constexpr Lut<T, N> makeLut(LutIndexes<I...>)
+{
+    return Lut<T, N>{{F(I, N)...}};
+}
+
+
+template<typename T, uint32_t N, T (*F)(uint32_t, uint32_t)>
+constexpr Lut<T, N> makeLut(void)
+{
+    return makeLut<T, N, F>(typename MakeLutIndexes<N>::type());
+}
+
+
+#endif /* LUT_H */
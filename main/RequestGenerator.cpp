@@ -8,11 +8,11 @@
 
 #define HUE_URL "http://" HUE_IP "/api/"
 #define HUE_USERNAME "hVC1QjzakMA58CjXBPy2wRB3KX3GZvZccI66o9dx"
-#define HUE_LIGHTS HUE_URL HUE_USERNAME "/lights"
+#define HUE_RESOURCE HUE_URL HUE_USERNAME "/%s"
 #define HUE_LAMP HUE_URL HUE_USERNAME "/lights/%d/state"
 #define HUE_GROUP HUE_URL HUE_USERNAME "/groups/%d/action"
 
-#define GET_REQUEST "GET " HUE_LIGHTS " HTTP/1.0\r\n" \
+#define GET_REQUEST "GET " HUE_RESOURCE " HTTP/1.0\r\n" \
     "Host: " HUE_IP "\r\n" \
     "\r\n" 
 
@@ -21,16 +21,41 @@
     "Content-Length: %d\r\n" \
     "\r\n"
 
+#define PUT_GROUP_REQUEST "PUT " HUE_GROUP " HTTP/1.1\r\n" \
+    "Host: " HUE_IP "\r\n" \
+    "Content-Length: %d\r\n" \
+    "\r\n"
 
-int32_t RequestGenerator::get(char* outputBuffer, uint32_t bufferSize)
-{
-    const int32_t contentLen = strlen(GET_REQUEST) + 1;
+#define SCENE_REQUEST "%s " HUE_URL HUE_USERNAME "/scenes%s%s HTTP/1.1\r\n" \
+    "Host: " HUE_IP "\r\n" \
+    "Content-Length: %d\r\n" \
+    "\r\n"
 
-    if(bufferSize < contentLen) return -1;
+#define LIGHTSTATE_REQUEST "PUT " HUE_URL HUE_USERNAME \
+    "/scenes/%s/lightstates/%d HTTP/1.1\r\n" \
+    "Host: " HUE_IP "\r\n" \
+    "Content-Length: %d\r\n" \
+    "\r\n"
 
-    strncpy(outputBuffer, GET_REQUEST, bufferSize);
 
-    return contentLen;
+static int32_t addHeader(char* outputBuffer, uint32_t bufferSize, 
+        const char* format, char* content, uint32_t contentLen, 
+        uint8_t id);
+
+static int32_t addContent(char* outputBuffer, uint32_t bufferSize, 
+        int32_t headerLen, char* content, uint32_t contentLen);
+
+
+int32_t RequestGenerator::get(char* outputBuffer, uint32_t bufferSize, 
+        const char* resource)
+{
+    int32_t requestLen = snprintf(outputBuffer, bufferSize, GET_REQUEST, 
+        resource);
+
+    /* Check size */
+    if((requestLen < 0) || ((uint32_t)requestLen >= bufferSize)) return -1;
+
+    return requestLen;
 }
 
 
@@ -91,15 +116,159 @@ int32_t RequestGenerator::put(char* outputBuffer, uint32_t bufferSize,
 }
 
 
+int32_t RequestGenerator::recallScene(char* outputBuffer, 
+        uint32_t bufferSize, const char* sceneId)
+{
+    int32_t contentLen = snprintf(outputBuffer, bufferSize, 
+        "{\"scene\": \"%s\"}", sceneId);
+
+    /* Check size */
+    if((contentLen < 0) || ((uint32_t)contentLen >= bufferSize)) return -1;
+
+    return contentLen;
+}
+
+
+int32_t RequestGenerator::createScene(char* outputBuffer, 
+        uint32_t bufferSize, const char* name, const char* appData, 
+        const sceneLamp_s* lamps, uint32_t numLamps)
+{
+    int32_t contentLen = 0;
+
+    if((contentLen += snprintf(outputBuffer + contentLen, 
+        bufferSize - contentLen, "{\"name\": \"%s\", \"recycle\": false, "
+        "\"appdata\": {\"version\": 1, \"data\": \"%s\"}, \"lights\": [", 
+        name, appData)) >= bufferSize) return -1;
+
+    for(uint32_t i = 0; i < numLamps; i++)
+    {
+        if((contentLen += snprintf(outputBuffer + contentLen, 
+            bufferSize - contentLen, "\"%d\",", lamps[i].id)) >= bufferSize) 
+            return -1;
+    }
+
+    /* Replace the trailing comma of the lamp list */
+    if(numLamps > 0) contentLen--;
+
+    if((contentLen += snprintf(outputBuffer + contentLen, 
+        bufferSize - contentLen, "], \"lightstates\": {")) >= bufferSize) 
+        return -1;
+
+    for(uint32_t i = 0; i < numLamps; i++)
+    {
+        const sceneLamp_s& lamp = lamps[i];
+
+        if((contentLen += snprintf(outputBuffer + contentLen, 
+            bufferSize - contentLen, "\"%d\": {\"on\": %s", lamp.id, 
+            (lamp.on ? "true" : "false"))) >= bufferSize) return -1;
+
+        if(lamp.bri >= 0)
+        {
+            if((contentLen += snprintf(outputBuffer + contentLen, 
+                bufferSize - contentLen, ", \"bri\": %d", lamp.bri)) >= 
+                bufferSize) return -1;
+        }
+
+        if(lamp.hue >= 0)
+        {
+            if((contentLen += snprintf(outputBuffer + contentLen, 
+                bufferSize - contentLen, ", \"hue\": %d", lamp.hue)) >= 
+                bufferSize) return -1;
+        }
+
+        if(lamp.sat >= 0)
+        {
+            if((contentLen += snprintf(outputBuffer + contentLen, 
+                bufferSize - contentLen, ", \"sat\": %d", lamp.sat)) >= 
+                bufferSize) return -1;
+        }
+
+        if(lamp.ct >= 0)
+        {
+            if((contentLen += snprintf(outputBuffer + contentLen, 
+                bufferSize - contentLen, ", \"ct\": %d", lamp.ct)) >= 
+                bufferSize) return -1;
+        }
+
+        if((contentLen += snprintf(outputBuffer + contentLen, 
+            bufferSize - contentLen, "},")) >= bufferSize) return -1;
+    }
+
+    if(numLamps > 0) contentLen--;
+
+    if((contentLen += snprintf(outputBuffer + contentLen, 
+        bufferSize - contentLen, "}}")) >= bufferSize) return -1;
+
+    return contentLen;
+}
+
+
 int32_t RequestGenerator::addPutHeader(char* outputBuffer, uint32_t bufferSize, 
         char* content, uint32_t contentLen, uint8_t lampId)
+{
+    return addHeader(outputBuffer, bufferSize, PUT_REQUEST, 
+        content, contentLen, lampId);
+}
+
+
+int32_t RequestGenerator::addGroupPutHeader(char* outputBuffer, 
+        uint32_t bufferSize, char* content, uint32_t contentLen, 
+        uint8_t groupId)
+{
+    return addHeader(outputBuffer, bufferSize, PUT_GROUP_REQUEST, 
+        content, contentLen, groupId);
+}
+
+
+int32_t RequestGenerator::addSceneHeader(char* outputBuffer, 
+        uint32_t bufferSize, const char* method, char* content, 
+        uint32_t contentLen, const char* sceneId)
+{
+    int32_t headerLen = 0;
+
+    /* Generate header, without scene ID for the whole collection */
+	if((headerLen = snprintf(outputBuffer, bufferSize, SCENE_REQUEST, 
+        method, (sceneId ? "/" : ""), (sceneId ? sceneId : ""), 
+        contentLen)) < 0) return -1;
+
+    return addContent(outputBuffer, bufferSize, headerLen, 
+        content, contentLen);
+}
+
+
+int32_t RequestGenerator::addLightstateHeader(char* outputBuffer, 
+        uint32_t bufferSize, char* content, uint32_t contentLen, 
+        const char* sceneId, uint8_t lampId)
+{
+    int32_t headerLen = 0;
+
+    /* Generate header */
+	if((headerLen = snprintf(outputBuffer, bufferSize, LIGHTSTATE_REQUEST, 
+        sceneId, lampId, contentLen)) < 0) return -1;
+
+    return addContent(outputBuffer, bufferSize, headerLen, 
+        content, contentLen);
+}
+
+
+static int32_t addHeader(char* outputBuffer, uint32_t bufferSize, 
+        const char* format, char* content, uint32_t contentLen, 
+        uint8_t id)
 {
     int32_t headerLen = 0;
 
     /* Generate header */
-	if((headerLen = snprintf(outputBuffer, bufferSize, PUT_REQUEST, lampId, 
+	if((headerLen = snprintf(outputBuffer, bufferSize, format, id, 
         contentLen)) < 0) return -1;
 
+    return addContent(outputBuffer, bufferSize, headerLen, 
+        content, contentLen);
+}
+
+
+static int32_t addContent(char* outputBuffer, uint32_t bufferSize, 
+        int32_t headerLen, char* content, uint32_t contentLen)
+{
     /* Check size */
 	if((headerLen + contentLen + 1) > bufferSize) return -1;
 
@@ -108,4 +277,3 @@ int32_t RequestGenerator::addPutHeader(char* outputBuffer, uint32_t bufferSize,
 
 	return strlen(outputBuffer);
 }
-    
\ No newline at end of file
@@ -9,14 +9,51 @@ class RequestGenerator
 {
 public:
 
-    static int32_t get(char* outputBuffer, uint32_t bufferSize);
+    /* Light state of a lamp in a scene, negative values are not sent */
+    struct sceneLamp_s
+    {
+        uint8_t id;
+        bool on;
+        int16_t bri;
+        int32_t hue;
+        int16_t sat;
+        int32_t ct;
+    };
+
+    /* Upper bounds of the scene body: the fixed part with name and 
+     * application data, and the list entry plus light state of a lamp */
+    static const uint32_t SCENE_BASE_LEN = 160;
+    static const uint32_t SCENE_LAMP_LEN = 72;
+
+    static int32_t get(char* outputBuffer, uint32_t bufferSize, 
+        const char* resource = "lights");
 
     static int32_t put(char* outputBuffer, uint32_t bufferSize, 
         int8_t on, int16_t bri, int32_t hue, int16_t sat, 
         int32_t ct, int32_t transitiontime);
 
+    static int32_t recallScene(char* outputBuffer, uint32_t bufferSize, 
+        const char* sceneId);
+
+    static int32_t createScene(char* outputBuffer, uint32_t bufferSize, 
+        const char* name, const char* appData, const sceneLamp_s* lamps, 
+        uint32_t numLamps);
+
     static int32_t addPutHeader(char* outputBuffer, uint32_t bufferSize, 
         char* content, uint32_t contentLen, uint8_t lampId);
+
+    static int32_t addGroupPutHeader(char* outputBuffer, uint32_t bufferSize, 
+        char* content, uint32_t contentLen, uint8_t groupId);
+
+    static int32_t addSceneHeader(char* outputBuffer, uint32_t bufferSize, 
+        const char* method, char* content, uint32_t contentLen, 
+        const char* sceneId);
+
+    /* Changes the light state of a lamp stored in a scene, the content is 
+     * that of put() without a transition time */
+    static int32_t addLightstateHeader(char* outputBuffer, uint32_t bufferSize, 
+        char* content, uint32_t contentLen, const char* sceneId, 
+        uint8_t lampId);
 };
 
 
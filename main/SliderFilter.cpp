@@ -0,0 +1,75 @@
+#include "SliderFilter.h"
+
+#include <math.h>
+
+
+SliderFilter::SliderFilter(uint32_t sampleRate)
+{
+    m_Rate = (float)sampleRate / DECIMATION;
+
+    reset();
+}
+
+
+void SliderFilter::reset(void)
+{
+    m_BlockLen = 0;
+    m_Primed = false;
+    m_Value = 0.0f;
+    m_Speed = 0.0f;
+}
+
+
+bool SliderFilter::addSample(uint16_t sample, uint16_t* returnValue)
+{
+    m_Block[m_BlockLen++] = sample;
+    if(m_BlockLen < DECIMATION) return false;
+
+    m_BlockLen = 0;
+    float x = median();
+
+    if(m_Primed == false)
+    {
+        m_Primed = true;
+        m_Value = x;
+        m_Speed = 0.0f;
+    }
+    else
+    {
+        /* The speed is smoothed as well, it only steers the cutoff */
+        float speed = (x - m_Value) * m_Rate;
+        m_Speed += alpha(m_SpeedCutoff) * (speed - m_Speed);
+
+        float cutoff = m_MinCutoff + m_Beta * fabsf(m_Speed);
+        m_Value += alpha(cutoff) * (x - m_Value);
+    }
+
+    *returnValue = (uint16_t)(m_Value + 0.5f);
+    return true;
+}
+
+
+float SliderFilter::alpha(float cutoff) const
+{
+    float tau = 1.0f / (2.0f * (float)M_PI * cutoff);
+
+    return 1.0f / (1.0f + tau * m_Rate);
+}
+
+
+uint16_t SliderFilter::median(void)
+{
+    /* Insertion sort of the few samples of a block */
+    for(uint32_t i = 1; i < DECIMATION; i++)
+    {
+        uint16_t sample = m_Block[i];
+        uint32_t j = i;
+
+        for(; (j > 0) && (m_Block[j - 1] > sample); j--)
+            m_Block[j] = m_Block[j - 1];
+
+        m_Block[j] = sample;
+    }
+
+    return m_Block[DECIMATION / 2];
+}
@@ -0,0 +1,49 @@
+#ifndef SLIDERFILTER_H
+#define SLIDERFILTER_H
+
+
+#include <stdint.h>
+
+
+/* Smooths the raw ADC samples of the slider. Blocks of samples are 
+ * decimated to their median, which removes single sample spikes, and the 
+ * medians pass a one euro filter: a low pass whose cutoff rises with the 
+ * speed of the slider, so a resting slider is steady while a moving one 
+ * is followed closely. */
+class SliderFilter
+{
+public:
+
+    static const uint32_t DECIMATION = 5;
+
+    /* sampleRate is the rate of the raw samples in Hz */
+    SliderFilter(uint32_t sampleRate);
+
+    void reset(void);
+
+    /* Returns true and the filtered value every DECIMATION samples */
+    bool addSample(uint16_t sample, uint16_t* returnValue);
+
+private:
+
+    /* Cutoff of a resting slider and its increase per ADC step/s of 
+     * speed, both in Hz */
+    static constexpr float m_MinCutoff = 1.0f;
+    static constexpr float m_Beta = 0.005f;
+    static constexpr float m_SpeedCutoff = 1.0f;
+
+    float alpha(float cutoff) const;
+    uint16_t median(void);
+
+    float m_Rate;
+
+    uint16_t m_Block[DECIMATION];
+    uint32_t m_BlockLen;
+
+    bool m_Primed;
+    float m_Value;
+    float m_Speed;
+};
+
+
+#endif /* SLIDERFILTER_H */
@@ -0,0 +1,67 @@
+#include "SliderPredictor.h"
+
+#include <math.h>
+
+
+#define ADC_MAX         1023
+
+
+SliderPredictor::SliderPredictor(uint32_t rate)
+{
+    m_Rate = (float)rate;
+
+    reset();
+}
+
+
+void SliderPredictor::reset(void)
+{
+    m_Primed = false;
+    m_Predicting = false;
+    m_Value = 0.0f;
+    m_Speed = 0.0f;
+    m_Accel = 0.0f;
+}
+
+
+uint16_t SliderPredictor::update(uint16_t value, uint32_t leadTime)
+{
+    float x = value;
+
+    if(m_Primed == false)
+    {
+        m_Primed = true;
+        m_Value = x;
+        m_Speed = 0.0f;
+        m_Accel = 0.0f;
+    }
+    else
+    {
+        float speed = (x - m_Value) * m_Rate;
+        float accel = (speed - m_Speed) * m_Rate;
+
+        m_Speed += m_Smoothing * (speed - m_Speed);
+        m_Accel += m_Smoothing * (accel - m_Accel);
+        m_Value = x;
+    }
+
+    m_Predicting = (leadTime > 0) && (fabsf(m_Speed) >= m_RestSpeed);
+    if(m_Predicting == false) return value;
+
+    float lead = leadTime / 1000.0f;
+    float move = m_Speed * lead;
+
+    /* The acceleration is noisy, it may slow the move down to a stop but 
+     * neither reverse it nor more than double it */
+    float bend = 0.5f * m_Accel * lead * lead;
+    if(move > 0.0f) bend = fmaxf(-move, fminf(bend, move));
+    else bend = fminf(-move, fmaxf(bend, move));
+
+    float ahead = fmaxf(-m_MaxLead, fminf(move + bend, m_MaxLead));
+    float predicted = x + ahead;
+
+    if(predicted < 0.0f) return 0;
+    if(predicted > ADC_MAX) return ADC_MAX;
+
+    return (uint16_t)(predicted + 0.5f);
+}
@@ -0,0 +1,50 @@
+#ifndef SLIDERPREDICTOR_H
+#define SLIDERPREDICTOR_H
+
+
+#include <stdint.h>
+
+
+/* Extrapolates the filtered slider to where it is expected to be when a 
+ * command sent now reaches the lamps. Speed and acceleration are smoothed 
+ * differences of the filtered values. Once the slider slows down below 
+ * m_RestSpeed the exact value is returned again, which corrects any 
+ * overshoot when the slider is released. */
+class SliderPredictor
+{
+public:
+
+    /* rate is the rate of the filtered values in Hz */
+    SliderPredictor(uint32_t rate);
+
+    void reset(void);
+
+    /* Returns the value expected after leadTime ms */
+    uint16_t update(uint16_t value, uint32_t leadTime);
+
+    /* True while the last value returned was extrapolated */
+    bool predicting(void) const { return m_Predicting; }
+
+private:
+
+    /* Weight of a new difference in the speed and acceleration, and the 
+     * speed in ADC steps/s below which the slider counts as held */
+    static constexpr float m_Smoothing = 0.5f;
+    static constexpr float m_RestSpeed = 40.0f;
+
+    /* ADC steps the prediction may be ahead of the filtered value. The 
+     * filter lags most while the hand speeds up, unbounded a fast flick 
+     * was predicted to the end of the slider. */
+    static constexpr float m_MaxLead = 80.0f;
+
+    float m_Rate;
+
+    bool m_Primed;
+    bool m_Predicting;
+    float m_Value;
+    float m_Speed;
+    float m_Accel;
+};
+
+
+#endif /* SLIDERPREDICTOR_H */
@@ -0,0 +1,120 @@
+#include "Trace.h"
+
+#include "esp8266.h"
+
+#include <esp_log.h>
+
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include <xtensa/xtruntime.h>
+
+#include <stdio.h>
+
+
+#define LOG_TAG "Trace"
+
+/* Spans kept, the oldest are overwritten */
+#define TRACE_RING_SIZE     256
+
+
+#ifdef CONFIG_LATENCY_TRACE
+
+typedef struct
+{
+    uint32_t cycles;
+    uint16_t id;
+    uint8_t stage;
+} trace_span_t;
+
+
+static const char* stageNames[TRACE_NUM_STAGES] = 
+{
+    "input", "event", "app", "request", "connect", "write", "first_byte", 
+    "close", "led"
+};
+
+static trace_span_t ring[TRACE_RING_SIZE];
+static uint32_t head = 0;
+static uint16_t lastId = 0;
+static volatile bool paused = false;
+
+static uint16_t currentId = 0;
+static TaskHandle_t currentTask = NULL;
+
+
+static void record(uint16_t id, uint8_t stage, uint32_t cycles)
+{
+    if(paused) return;
+
+    uint32_t level = XTOS_DISABLE_ALL_INTERRUPTS;
+
+    trace_span_t* span = &ring[head++ % TRACE_RING_SIZE];
+    span->cycles = cycles;
+    span->id = id;
+    span->stage = stage;
+
+    XTOS_RESTORE_INTLEVEL(level);
+}
+
+
+uint16_t trace_begin(uint32_t cycles)
+{
+    uint32_t level = XTOS_DISABLE_ALL_INTERRUPTS;
+
+    /* 0 stands for no trace */
+    uint16_t id = ++lastId;
+    if(id == 0) id = ++lastId;
+
+    XTOS_RESTORE_INTLEVEL(level);
+
+    record(id, TRACE_INPUT, cycles);
+    return id;
+}
+
+
+void trace_set_current(uint16_t id)
+{
+    currentTask = xTaskGetCurrentTaskHandle();
+    currentId = id;
+}
+
+
+void trace_mark(trace_stage_t stage)
+{
+    /* Other tasks share the code paths, e.g. the background task */
+    if((currentId == 0) || (xTaskGetCurrentTaskHandle() != currentTask)) 
+        return;
+
+    record(currentId, stage, getCycleCount());
+}
+
+
+void trace_dump(void)
+{
+    paused = true;
+
+    uint32_t end = head;
+    uint32_t start = (end > TRACE_RING_SIZE) ? end - TRACE_RING_SIZE : 0;
+
+    /* One line per span, oldest first, after the clock of the cycle 
+     * counter. host/trace_decode.py turns them into latencies. */
+    printf("TRACE_CLOCK %u\n", F_CPU);
+    for(uint32_t i = start; i < end; i++)
+    {
+        const trace_span_t* span = &ring[i % TRACE_RING_SIZE];
+        printf("TRACE %u %s %u\n", span->id, stageNames[span->stage], 
+            span->cycles);
+    }
+
+    paused = false;
+}
+
+#else
+
+uint16_t trace_begin(uint32_t cycles) { return 0; }
+void trace_set_current(uint16_t id) {}
+void trace_mark(trace_stage_t stage) {}
+void trace_dump(void) {}
+
+#endif /* CONFIG_LATENCY_TRACE */
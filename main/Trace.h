@@ -0,0 +1,47 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+
+#include <stdint.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/* Points an input event passes on its way to the lamps and the LEDs */
+typedef enum
+{
+    TRACE_INPUT = 0,    /* GPIO edge or ADC read, starts the trace */
+    TRACE_EVENT,        /* taken by the input task */
+    TRACE_APP,          /* handled by the app */
+    TRACE_REQUEST,      /* request generated */
+    TRACE_CONNECT,      /* socket connected */
+    TRACE_WRITE,        /* request written */
+    TRACE_FIRST_BYTE,   /* first byte of the response */
+    TRACE_CLOSE,        /* socket closed */
+    TRACE_LED,          /* LED strip updated */
+    TRACE_NUM_STAGES
+} trace_stage_t;
+
+
+/* Starts a trace at the given cycle count, callable from interrupts. 
+ * Returns its ID, 0 if tracing is disabled. */
+uint16_t trace_begin(uint32_t cycles);
+
+/* Following marks of the calling task belong to the trace, 0 ends it */
+void trace_set_current(uint16_t id);
+
+void trace_mark(trace_stage_t stage);
+
+/* Prints the recorded spans, oldest first, for decoding on the host */
+void trace_dump(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* TRACE_H */
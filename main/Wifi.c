@@ -1,6 +1,7 @@
 #include "Wifi.h"
 
 #include "main.h"
+#include "Trace.h"
 
 #include <esp_wifi.h>
 #include <esp_log.h>
@@ -13,6 +14,7 @@
 
 #include <FreeRTOS.h>
 #include <task.h>
+#include <semphr.h>
 #include <event_groups.h>
 
 #include <esp_event_loop.h>
@@ -36,11 +38,18 @@
     to make a request */
 static EventGroupHandle_t wifi_event_group;
 
+/* Serializes the socket between the tasks sending requests */
+static SemaphoreHandle_t wifi_mutex;
+
 static int socket;
 
 static struct sockaddr_in addr;
 
 
+static int32_t transfer(const char* sendData, const uint32_t sendDataLen,
+        char* recDataBuffer, uint32_t recDataBufferLen, uint32_t recDelay,
+        wifi_chunk_callback_t callback, void* context);
+
 static void errorHandler(void);
 
 static esp_err_t eventHandler(void* ctx, system_event_t* event);
@@ -52,6 +61,7 @@ void wifi_init(void)
 
     tcpip_adapter_init();
     wifi_event_group = xEventGroupCreate();
+    wifi_mutex = xSemaphoreCreateMutex();
     ESP_ERROR_CHECK( esp_event_loop_init(eventHandler, NULL) );
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK( esp_wifi_init(&cfg) );
@@ -89,6 +99,26 @@ void wifi_init(void)
 int32_t wifi_send(const char* sendData, const uint32_t sendDataLen,
         char* recDataBuffer, uint32_t recDataBufferLen, uint32_t recDelay)
 {
+    return transfer(sendData, sendDataLen, recDataBuffer, recDataBufferLen, 
+        recDelay, NULL, NULL);
+}
+
+
+int32_t wifi_send_stream(const char* sendData, const uint32_t sendDataLen,
+        char* chunkBuffer, uint32_t chunkBufferLen, uint32_t recDelay,
+        wifi_chunk_callback_t callback, void* context)
+{
+    return transfer(sendData, sendDataLen, chunkBuffer, chunkBufferLen, 
+        recDelay, callback, context);
+}
+
+
+static int32_t transfer(const char* sendData, const uint32_t sendDataLen,
+        char* recDataBuffer, uint32_t recDataBufferLen, uint32_t recDelay,
+        wifi_chunk_callback_t callback, void* context)
+{
+    xSemaphoreTake(wifi_mutex, portMAX_DELAY);
+
     socket = socket(AF_INET, SOCK_STREAM, 0);
     if(socket < 0)
     {
@@ -109,31 +139,47 @@ int32_t wifi_send(const char* sendData, const uint32_t sendDataLen,
         ERROR_HANDLER("... socket connect failed errno=%d", errno);
     }
 
+    trace_mark(TRACE_CONNECT);
+
     /* Send request */
     if (write(socket, sendData, sendDataLen) < 0)
     {
         ERROR_HANDLER("... socket send failed");
     }
 
+    trace_mark(TRACE_WRITE);
+
     if(recDelay > 0) vTaskDelay(recDelay);
 
-    /* Read HTTP response */
+    /* Read HTTP response, accumulated in the buffer or handed to the 
+     * callback chunk by chunk */
     int32_t retVal = 0;
     int32_t readLen = 0;
+    int32_t totalLen = 0;
     do
     {
         retVal = read(socket, recDataBuffer + readLen, 
                 recDataBufferLen - readLen);
 
-        readLen += retVal;
+        if(retVal > 0)
+        {
+            if(totalLen == 0) trace_mark(TRACE_FIRST_BYTE);
+            totalLen += retVal;
+
+            if(callback != NULL) callback(recDataBuffer, retVal, context);
+            else readLen += retVal;
+        }
         //printf("retVal: %d\n", retVal);
     }
     while(retVal > 0);
 
     close(socket);
+    trace_mark(TRACE_CLOSE);
+
+    xSemaphoreGive(wifi_mutex);
 
     if(retVal < 0) return retVal;
-    return readLen;
+    return totalLen;
 }
 
 
@@ -10,11 +10,20 @@ extern "C" {
 #endif
 
 
+/* Receives the response chunks of wifi_send_stream() in order */
+typedef void (*wifi_chunk_callback_t)(const char* data, uint32_t len, 
+        void* context);
+
+
 void wifi_init(void);
 
 int32_t wifi_send(const char* sendData, const uint32_t sendDataLen,
         char* recDataBuffer, uint32_t recDataBufferLen, uint32_t recDelay);
 
+int32_t wifi_send_stream(const char* sendData, const uint32_t sendDataLen,
+        char* chunkBuffer, uint32_t chunkBufferLen, uint32_t recDelay,
+        wifi_chunk_callback_t callback, void* context);
+
 
 #ifdef __cplusplus
 }
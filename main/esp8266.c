@@ -11,17 +11,13 @@
 #include "driver/gpio.h"
 #include "driver/hw_timer.h"
 
-#define F_CPU 80000000
+/* Period of the hardware timer, the base of micros() and of the tick hook */
+#define TICK_US 1000
 
-static uint32_t microsSeconds = 0;
-
-static uint32_t _getCycleCount(void) __attribute__((always_inline));
-static inline uint32_t _getCycleCount(void) {
-  uint32_t ccount;
-  __asm__ __volatile__("rsr %0,ccount":"=a" (ccount));
-  return ccount;
-}
+static volatile uint32_t tickCount = 0;
 
+static tickHook_t tickHook = NULL;
+static void* tickHookArg = NULL;
 
 void IRAM_ATTR espShow(
  uint8_t pin, uint8_t *pixels, uint32_t numBytes, uint8_t is800KHz) {
@@ -59,12 +55,12 @@ void IRAM_ATTR espShow(
 
   for(t = time0;; t = time0) {
     if(pix & mask) t = time1;                             // Bit high duration
-    while(((c = _getCycleCount()) - startTime) < period); // Wait for bit start
+    while(((c = getCycleCount()) - startTime) < period); // Wait for bit start
 
     GPIO_REG_WRITE(GPIO_OUT_W1TS_ADDRESS, pinMask);       // Set high
 
     startTime = c;                                        // Save start time
-    while(((c = _getCycleCount()) - startTime) < t);      // Wait high duration
+    while(((c = getCycleCount()) - startTime) < t);      // Wait high duration
 
     GPIO_REG_WRITE(GPIO_OUT_W1TC_ADDRESS, pinMask);       // Set low
 
@@ -74,7 +70,7 @@ void IRAM_ATTR espShow(
       mask = 0x80;
     }
   }
-  while((_getCycleCount() - startTime) < period); // Wait for last bit
+  while((getCycleCount() - startTime) < period); // Wait for last bit
 }
 
 
@@ -103,20 +99,52 @@ void digitalWrite(uint16_t pin, uint8_t level)
 }
 
 
-static void microsCallback(void *arg)
+static void tickCallback(void *arg)
 {
-    microsSeconds++;
+    tickCount++;
+
+    if(tickHook != NULL) tickHook(tickHookArg);
 }
 
 void initMicros(void)
 {
-    hw_timer_init(microsCallback, NULL);
-    hw_timer_alarm_us(1000000, true);
+    static bool initialized = false;
+    if(initialized) return;
+
+    initialized = true;
+
+    hw_timer_init(tickCallback, NULL);
+    hw_timer_alarm_us(TICK_US, true);
 }
 
 uint32_t micros(void)
 {
-    return ((microsSeconds * 1000000) + ((5000000 - hw_timer_get_count_data()) / 5));
+    uint32_t ticks, count;
+
+    /* Read again if the timer wrapped in between */
+    do
+    {
+        ticks = tickCount;
+        count = hw_timer_get_count_data();
+    } while(ticks != tickCount);
+
+    /* The timer counts down from the load value */
+    uint32_t load = hw_timer_get_load_data();
+
+    return (ticks * TICK_US) + (((load - count) * TICK_US) / load);
+}
+
+uint32_t millis(void)
+{
+    return tickCount * (TICK_US / 1000);
+}
+
+void setTickHook(tickHook_t hook, void* arg)
+{
+    portENTER_CRITICAL();
+    tickHook = hook;
+    tickHookArg = arg;
+    portEXIT_CRITICAL();
 }
 
 
@@ -30,16 +30,34 @@ extern "C" {
 #define LOW 0
 #define HIGH 1
 
+#ifndef F_CPU
+#define F_CPU 80000000
+#endif
+
 void pinMode(uint16_t pin, uint8_t dir);
 void digitalWrite(uint16_t pin, uint8_t level);
 void IRAM_ATTR espShow(uint8_t pin, uint8_t *pixels, uint32_t numBytes, uint8_t is800KHz);
 
+/* Called from the timer interrupt once per millisecond */
+typedef void (*tickHook_t)(void* arg);
+
 void initMicros(void);
 uint32_t micros(void);
+uint32_t millis(void);
+void setTickHook(tickHook_t hook, void* arg);
 
 void noInterrupts(void);
 void interrupts(void);
 
+/* CPU cycles, wraps after about 53 s */
+static inline uint32_t getCycleCount(void) __attribute__((always_inline));
+static inline uint32_t getCycleCount(void)
+{
+    uint32_t ccount;
+    __asm__ __volatile__("rsr %0,ccount":"=a" (ccount));
+    return ccount;
+}
+
 
 #ifdef __cplusplus
 }
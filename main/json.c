@@ -75,6 +75,109 @@ static int would_overflow (json_int_t value, json_char b)
    return ((JSON_INT_MAX - (b - '0')) / 10 ) < value;
 }
 
+/* Word at a time (SWAR) helpers, a word holds four characters
+ */
+#define swar_ones             ((uint32_t) 0x01010101UL)
+#define swar_has_zero(w)      (((w) - swar_ones) & ~(w) & (swar_ones * 0x80))
+#define swar_has_byte(w, c)   swar_has_zero ((w) ^ (swar_ones * (unsigned char) (c)))
+
+static uint32_t load_word (const json_char * ptr)
+{
+   uint32_t word;
+   memcpy (&word, ptr, sizeof (word));
+   return word;
+}
+
+/* Length of the run of string characters up to the next quote, escape or
+ * NUL character
+ */
+static size_t string_run (const json_char * ptr, const json_char * end)
+{
+   const json_char * start = ptr;
+
+   if (ptr >= end)
+      return 0;
+
+   while (end - ptr >= 4)
+   {
+      uint32_t word = load_word (ptr);
+
+      if (swar_has_byte (word, '"') || swar_has_byte (word, '\\')
+            || swar_has_zero (word))
+      {
+         break;
+      }
+
+      ptr += 4;
+   }
+
+   while (ptr < end && *ptr != '"' && *ptr != '\\' && *ptr)
+      ++ ptr;
+
+   return ptr - start;
+}
+
+/* Skips spaces, tabs and carriage returns. Line feeds are left to the
+ * parser, which counts the lines.
+ */
+static const json_char * skip_blanks (const json_char * ptr, const json_char * end)
+{
+   if (ptr >= end)
+      return ptr;
+
+   while (end - ptr >= 4 && load_word (ptr) == swar_ones * ' ')
+      ptr += 4;
+
+   while (ptr < end && (*ptr == ' ' || *ptr == '\t' || *ptr == '\r'))
+      ++ ptr;
+
+   return ptr;
+}
+
+/* Parses a run of up to 9 digits, which can not overflow. Returns the
+ * number of digits.
+ */
+static unsigned int parse_digits (const json_char * ptr, const json_char * end,
+                                  json_int_t * value)
+{
+   json_int_t result = 0;
+   unsigned int count = 0;
+
+   #if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+      /* Four digits at once, the first one is in the lowest byte */
+      while (count < 8 && end - ptr >= 4)
+      {
+         uint32_t word = load_word (ptr);
+
+         if ((word & 0xF0F0F0F0UL) != 0x30303030UL
+               || ((word + 0x06060606UL) & 0xF0F0F0F0UL) != 0x30303030UL)
+         {
+            break;
+         }
+
+         word -= 0x30303030UL;
+         word = (word * 10 + (word >> 8)) & 0x00FF00FFUL;
+         word = (word * 100 + (word >> 16)) & 0x0000FFFFUL;
+
+         result = (result * 10000) + word;
+         ptr += 4;
+         count += 4;
+      }
+
+   #endif
+
+   while (count < 9 && ptr < end && isdigit ((unsigned char) *ptr))
+   {
+      result = (result * 10) + (*ptr - '0');
+      ++ ptr;
+      ++ count;
+   }
+
+   *value = result;
+   return count;
+}
+
 typedef struct
 {
    unsigned long used_memory;
@@ -165,6 +268,13 @@ static int new_value (json_state * state,
 
          case json_string:
 
+            if (state->settings.settings & json_in_situ)
+            {
+               value->u.string.ptr = (json_char *) state->ptr + 1;
+               value->u.string.length = 0;
+               break;
+            }
+
             if (! (value->u.string.ptr = (json_char *) json_alloc
                (state, (value->u.string.length + 1) * sizeof (json_char), 0)) )
             {
@@ -403,6 +513,8 @@ json_value * json_parse_ex (json_settings * settings,
 
             if (b == '"')
             {
+               json_char * string_start = string;
+
                if (!state.first_pass)
                   string [string_length] = 0;
 
@@ -421,7 +533,18 @@ json_value * json_parse_ex (json_settings * settings,
                   case json_object:
 
                      if (state.first_pass)
-                        (*(json_char **) &top->u.object.values) += string_length + 1;
+                     {
+                        if (! (state.settings.settings & json_in_situ))
+                           (*(json_char **) &top->u.object.values) += string_length + 1;
+                     }
+                     else if (state.settings.settings & json_in_situ)
+                     {
+                        top->u.object.values [top->u.object.length].name
+                           = string_start;
+
+                        top->u.object.values [top->u.object.length].name_length
+                           = string_length;
+                     }
                      else
                      {  
                         top->u.object.values [top->u.object.length].name
@@ -442,11 +565,28 @@ json_value * json_parse_ex (json_settings * settings,
             }
             else
             {
-               string_add (b);
+               /* Take the whole run up to the next quote or escape, in
+                * situ strings move towards the start of the text */
+               size_t run = string_run (state.ptr, end);
+
+               if (!state.first_pass)
+                  memmove (string + string_length, state.ptr, run);
+
+               string_length += run;
+               state.ptr += run - 1;
                continue;
             }
          }
 
+         if ((b == ' ' || b == '\t' || b == '\r')
+               && ! (flags & (flag_line_comment | flag_block_comment))
+               && ((flags & (flag_seek_value | flag_done)) || top->type == json_object))
+         {
+            /* Whitespace is skipped in all these states */
+            state.ptr = skip_blanks (state.ptr, end) - 1;
+            continue;
+         }
+
          if (state.settings.settings & json_enable_comments)
          {
             if (flags & (flag_line_comment | flag_block_comment))
@@ -609,7 +749,7 @@ json_value * json_parse_ex (json_settings * settings,
 
                      case 't':
 
-                        if ((end - state.ptr) < 3 || *(++ state.ptr) != 'r' ||
+                        if ((end - state.ptr) < 4 || *(++ state.ptr) != 'r' ||
                             *(++ state.ptr) != 'u' || *(++ state.ptr) != 'e')
                         {
                            goto e_unknown_value;
@@ -625,7 +765,7 @@ json_value * json_parse_ex (json_settings * settings,
 
                      case 'f':
 
-                        if ((end - state.ptr) < 4 || *(++ state.ptr) != 'a' ||
+                        if ((end - state.ptr) < 5 || *(++ state.ptr) != 'a' ||
                             *(++ state.ptr) != 'l' || *(++ state.ptr) != 's' ||
                             *(++ state.ptr) != 'e')
                         {
@@ -640,7 +780,7 @@ json_value * json_parse_ex (json_settings * settings,
 
                      case 'n':
 
-                        if ((end - state.ptr) < 3 || *(++ state.ptr) != 'u' ||
+                        if ((end - state.ptr) < 4 || *(++ state.ptr) != 'u' ||
                             *(++ state.ptr) != 'l' || *(++ state.ptr) != 'l')
                         {
                            goto e_unknown_value;
@@ -721,7 +861,11 @@ json_value * json_parse_ex (json_settings * settings,
 
                      flags |= flag_string;
 
-                     string = (json_char *) top->_reserved.object_mem;
+                     if (state.settings.settings & json_in_situ)
+                        string = (json_char *) state.ptr + 1;
+                     else
+                        string = (json_char *) top->_reserved.object_mem;
+
                      string_length = 0;
 
                      break;
@@ -751,6 +895,15 @@ json_value * json_parse_ex (json_settings * settings,
 
                if (isdigit ((unsigned char)b))
                {
+                  if (top->type == json_integer && !num_digits && b != '0'
+                        && ! (flags & flag_num_e))
+                  {
+                     /* The leading digits can not overflow */
+                     num_digits = parse_digits (state.ptr, end, &top->u.integer);
+                     state.ptr += (unsigned int) num_digits - 1;
+                     continue;
+                  }
+
                   ++ num_digits;
 
                   if (top->type == json_integer || flags & flag_num_e)
@@ -1017,7 +1170,9 @@ void json_value_free_ex (json_settings * settings, json_value * value)
 
          case json_string:
 
-            settings->mem_free (value->u.string.ptr, settings->user_data);
+            if (! (settings->settings & json_in_situ))
+               settings->mem_free (value->u.string.ptr, settings->user_data);
+
             break;
 
          default:
@@ -74,6 +74,10 @@ typedef struct
 
 #define json_enable_comments  0x01
 
+/* Keys and strings point into the source text, which is unescaped in place.
+ * The text must be writable and outlive the tree. */
+#define json_in_situ          0x02
+
 typedef enum
 {
    json_none,